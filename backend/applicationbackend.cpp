@@ -6,12 +6,16 @@
 
 #include "logger.h"
 #include "deviceregistry.h"
+#include "fleetmanager.h"
 #include "firmwareupdateregistry.h"
 
 #include "preferences.h"
 #include "flipperupdates.h"
 
 #include "serialdevice/screenstreamer.h"
+#include "serialdevice/screenrecorder.h"
+#include "serialdevice/screenplayer.h"
+#include "serialdevice/screenframerenderer.h"
 #include "serialdevice/virtualdisplay.h"
 #include "serialdevice/filemanager.h"
 
@@ -36,8 +40,12 @@ ApplicationBackend::ApplicationBackend(QObject *parent):
     m_deviceRegistry(new DeviceRegistry(this)),
     m_firmwareUpdateRegistry(new FirmwareUpdateRegistry("https://update.flipperzero.one/firmware/directory.json", this)),
     m_screenStreamer(new ScreenStreamer(this)),
+    m_screenRecorder(new ScreenRecorder(m_screenStreamer, this)),
+    m_screenPlayer(new ScreenPlayer(this)),
+    m_screenFrameRenderer(new ScreenFrameRenderer(m_screenStreamer, this)),
     m_virtualDisplay(new VirtualDisplay(this)),
     m_fileManager(new FileManager(this)),
+    m_fleetManager(new FleetManager(m_deviceRegistry, m_firmwareUpdateRegistry, this)),
     m_backendState(BackendState::WaitingForDevices),
     m_errorType(BackendError::UnknownError)
 {
@@ -112,6 +120,21 @@ ScreenStreamer *ApplicationBackend::screenStreamer() const
     return m_screenStreamer;
 }
 
+ScreenRecorder *ApplicationBackend::screenRecorder() const
+{
+    return m_screenRecorder;
+}
+
+ScreenPlayer *ApplicationBackend::screenPlayer() const
+{
+    return m_screenPlayer;
+}
+
+ScreenFrameRenderer *ApplicationBackend::screenFrameRenderer() const
+{
+    return m_screenFrameRenderer;
+}
+
 VirtualDisplay *ApplicationBackend::virtualDisplay() const
 {
     return m_virtualDisplay;
@@ -122,6 +145,11 @@ FileManager *ApplicationBackend::fileManager() const
     return m_fileManager;
 }
 
+FleetManager *ApplicationBackend::fleetManager() const
+{
+    return m_fleetManager;
+}
+
 const Updates::VersionInfo ApplicationBackend::latestFirmwareVersion() const
 {
     return m_firmwareUpdateRegistry->latestVersion();
@@ -284,6 +312,11 @@ void ApplicationBackend::onDeviceInfoChanged()
 
 void ApplicationBackend::onDeviceOperationFinished()
 {
+    // Fleet operations report their results through the fleet model
+    if(m_fleetManager->isRunning()) {
+        return;
+    }
+
     if(!device()) {
         qCDebug(LOG_BACKEND) << "Lost all connected devices";
         setErrorType(BackendError::UnknownError);
@@ -410,8 +443,12 @@ void ApplicationBackend::registerMetaTypes()
     qRegisterMetaType<Flipper::SerialDevice*>("Flipper::SerialDevice*");
     qRegisterMetaType<Flipper::Serial::DeviceState*>("Flipper::Serial::DeviceState*");
     qRegisterMetaType<Flipper::Serial::ScreenStreamer*>("Flipper::Serial::ScreenStreamer*");
+    qRegisterMetaType<Flipper::Serial::ScreenRecorder*>("Flipper::Serial::ScreenRecorder*");
+    qRegisterMetaType<Flipper::Serial::ScreenPlayer*>("Flipper::Serial::ScreenPlayer*");
+    qRegisterMetaType<Flipper::Serial::ScreenFrameRenderer*>("Flipper::Serial::ScreenFrameRenderer*");
     qRegisterMetaType<Flipper::Serial::VirtualDisplay*>("Flipper::Serial::VirtualDisplay*");
     qRegisterMetaType<Flipper::Serial::FileManager*>("Flipper::Serial::FileManager*");
+    qRegisterMetaType<Flipper::FleetManager*>("Flipper::FleetManager*");
     qRegisterMetaType<Flipper::Serial::ScreenStreamer*>("Flipper::Serial::ScreenStreamer*");
 
     qRegisterMetaType<Flipper::Serial::AssetManifest::FileInfo>();
@@ -10,17 +10,25 @@ namespace Flipper {
 class SerialDevice;
 class DeviceRegistry;
 class UpdateRegistry;
+class FleetManager;
 
 namespace Serial {
 class DeviceState;
 class FileManager;
+class ScreenFrameRenderer;
+class ScreenPlayer;
+class ScreenRecorder;
 class ScreenStreamer;
 class VirtualDisplay;
 }}
 
 #if QT_VERSION >= 0x060000
+Q_MOC_INCLUDE("fleetmanager.h")
 Q_MOC_INCLUDE("serialdevice/devicestate.h")
 Q_MOC_INCLUDE("serialdevice/screenstreamer.h")
+Q_MOC_INCLUDE("serialdevice/screenrecorder.h")
+Q_MOC_INCLUDE("serialdevice/screenplayer.h")
+Q_MOC_INCLUDE("serialdevice/screenframerenderer.h")
 Q_MOC_INCLUDE("serialdevice/virtualdisplay.h")
 Q_MOC_INCLUDE("serialdevice/filemanager.h")
 #endif
@@ -31,8 +39,12 @@ class ApplicationBackend : public QObject
     Q_PROPERTY(BackendState backendState READ backendState NOTIFY backendStateChanged)
     Q_PROPERTY(Flipper::Serial::DeviceState* deviceState READ deviceState NOTIFY currentDeviceChanged)
     Q_PROPERTY(Flipper::Serial::ScreenStreamer* screenStreamer READ screenStreamer CONSTANT)
+    Q_PROPERTY(Flipper::Serial::ScreenRecorder* screenRecorder READ screenRecorder CONSTANT)
+    Q_PROPERTY(Flipper::Serial::ScreenPlayer* screenPlayer READ screenPlayer CONSTANT)
+    Q_PROPERTY(Flipper::Serial::ScreenFrameRenderer* screenFrameRenderer READ screenFrameRenderer CONSTANT)
     Q_PROPERTY(Flipper::Serial::VirtualDisplay* virtualDisplay READ virtualDisplay CONSTANT)
     Q_PROPERTY(Flipper::Serial::FileManager* fileManager READ fileManager CONSTANT)
+    Q_PROPERTY(Flipper::FleetManager* fleetManager READ fleetManager CONSTANT)
     Q_PROPERTY(FirmwareUpdateState firmwareUpdateState READ firmwareUpdateState NOTIFY firmwareUpdateStateChanged)
     Q_PROPERTY(QAbstractListModel* firmwareUpdateModel READ firmwareUpdateModel CONSTANT)
     Q_PROPERTY(Flipper::Updates::VersionInfo latestFirmwareVersion READ latestFirmwareVersion NOTIFY firmwareUpdateStateChanged)
@@ -81,8 +93,12 @@ public:
     Flipper::DeviceRegistry *deviceRegistry() const;
 
     Flipper::Serial::ScreenStreamer *screenStreamer() const;
+    Flipper::Serial::ScreenRecorder *screenRecorder() const;
+    Flipper::Serial::ScreenPlayer *screenPlayer() const;
+    Flipper::Serial::ScreenFrameRenderer *screenFrameRenderer() const;
     Flipper::Serial::VirtualDisplay *virtualDisplay() const;
     Flipper::Serial::FileManager *fileManager() const;
+    Flipper::FleetManager *fleetManager() const;
 
     FirmwareUpdateState firmwareUpdateState() const;
     QAbstractListModel *firmwareUpdateModel() const;
@@ -144,8 +160,12 @@ private:
     Flipper::UpdateRegistry *m_firmwareUpdateRegistry;
 
     Flipper::Serial::ScreenStreamer *m_screenStreamer;
+    Flipper::Serial::ScreenRecorder *m_screenRecorder;
+    Flipper::Serial::ScreenPlayer *m_screenPlayer;
+    Flipper::Serial::ScreenFrameRenderer *m_screenFrameRenderer;
     Flipper::Serial::VirtualDisplay *m_virtualDisplay;
     Flipper::Serial::FileManager *m_fileManager;
+    Flipper::FleetManager *m_fleetManager;
 
     BackendState m_backendState;
     BackendError::ErrorType m_errorType;
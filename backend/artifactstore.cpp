@@ -0,0 +1,278 @@
+#include "artifactstore.h"
+
+#include <QFile>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QStandardPaths>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(LOG_ARTIFACTS, "ART")
+
+#define ARTIFACTS_DIR_NAME QStringLiteral("artifacts")
+#define EXTRACTED_MARKER QStringLiteral(".complete")
+#define MAX_SIZE (2LL * 1024 * 1024 * 1024)
+#define DIR_SUFFIX QStringLiteral(".d")
+#define PARTIAL_SUFFIX QStringLiteral(".part")
+// No extraction takes this long, such directories are left over from a crash
+#define INCOMPLETE_MAX_AGE_SECS (24 * 60 * 60)
+
+static qint64 entrySize(const QFileInfo &fileInfo)
+{
+    if(!fileInfo.isDir()) {
+        return fileInfo.size();
+    }
+
+    qint64 size = 0;
+    QDirIterator it(fileInfo.absoluteFilePath(), QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+
+    while(it.hasNext()) {
+        it.next();
+        size += it.fileInfo().size();
+    }
+
+    return size;
+}
+
+ArtifactStore::ArtifactStore():
+    m_root(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+{
+    if(!m_root.mkpath(ARTIFACTS_DIR_NAME) || !m_root.cd(ARTIFACTS_DIR_NAME)) {
+        qCWarning(LOG_ARTIFACTS) << "Failed to create artifact store directory";
+        return;
+    }
+
+    // Clean up after the extractions interrupted by the previous run
+    evict();
+}
+
+ArtifactStore *ArtifactStore::instance()
+{
+    static ArtifactStore instance;
+    return &instance;
+}
+
+QDir ArtifactStore::root() const
+{
+    return m_root;
+}
+
+QFile *ArtifactStore::file(const QByteArray &checksum, QObject *parent)
+{
+    QMutexLocker locker(&m_mutex);
+
+    const auto path = filePath(checksum);
+
+    if(checksum.isEmpty() || !QFile::exists(path)) {
+        return nullptr;
+    }
+
+    qCDebug(LOG_ARTIFACTS).noquote() << "Cache hit:" << checksum;
+
+    touch(path);
+    return new QFile(path, parent);
+}
+
+QFile *ArtifactStore::insert(const QByteArray &checksum, QFile *file, QObject *parent)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if(checksum.isEmpty()) {
+        return nullptr;
+    }
+
+    const auto path = filePath(checksum);
+
+    // Another operation might have stored the same artifact in the meantime
+    if(QFile::exists(path)) {
+        file->remove();
+
+    } else if(!file->rename(path)) {
+        qCWarning(LOG_ARTIFACTS).noquote() << "Failed to store artifact:" << file->errorString();
+        return nullptr;
+    }
+
+    touch(path);
+    evict();
+
+    return QFile::exists(path) ? new QFile(path, parent) : nullptr;
+}
+
+const QString ArtifactStore::extractPath(const QByteArray &checksum)
+{
+    QMutexLocker locker(&m_mutex);
+
+    const auto path = dirPath(checksum);
+
+    if(checksum.isEmpty() || !m_root.mkpath(path)) {
+        return QString();
+    }
+
+    touch(path);
+    return path;
+}
+
+bool ArtifactStore::isExtracted(const QByteArray &checksum)
+{
+    QMutexLocker locker(&m_mutex);
+    return !checksum.isEmpty() && QFile::exists(QDir(dirPath(checksum)).absoluteFilePath(EXTRACTED_MARKER));
+}
+
+bool ArtifactStore::beginExtraction(const QByteArray &checksum)
+{
+    QMutexLocker locker(&m_mutex);
+
+    const auto key = checksum.toLower();
+
+    if(checksum.isEmpty() || m_activeExtractions.contains(key)) {
+        return false;
+    }
+
+    m_activeExtractions.insert(key);
+    return true;
+}
+
+void ArtifactStore::endExtraction(const QByteArray &checksum, bool isComplete)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_activeExtractions.remove(checksum.toLower());
+
+    const auto path = dirPath(checksum);
+
+    if(checksum.isEmpty() || !QFileInfo(path).isDir()) {
+        return;
+
+    } else if(!isComplete) {
+        evict();
+        return;
+    }
+
+    QFile marker(QDir(path).absoluteFilePath(EXTRACTED_MARKER));
+
+    if(!marker.open(QIODevice::WriteOnly)) {
+        qCWarning(LOG_ARTIFACTS).noquote() << "Failed to mark artifact as extracted:" << marker.errorString();
+        return;
+    }
+
+    marker.close();
+
+    touch(path);
+    evict();
+}
+
+QFile *ArtifactStore::partialFile(const QByteArray &checksum, QObject *parent)
+{
+    QMutexLocker locker(&m_mutex);
+
+    const auto key = checksum.toLower();
+
+    if(checksum.isEmpty() || m_activeDownloads.contains(key)) {
+        return nullptr;
+    }
+
+    m_activeDownloads.insert(key);
+
+    auto *file = new QFile(filePath(checksum) + PARTIAL_SUFFIX, parent);
+
+    QObject::connect(file, &QObject::destroyed, [this, key]() {
+        QMutexLocker locker(&m_mutex);
+        m_activeDownloads.remove(key);
+    });
+
+    return file;
+}
+
+bool ArtifactStore::isStored(const QFile *file) const
+{
+    return QFileInfo(*file).absoluteDir() == m_root;
+}
+
+const QString ArtifactStore::filePath(const QByteArray &checksum) const
+{
+    return m_root.absoluteFilePath(QString::fromLatin1(checksum.toLower()));
+}
+
+const QString ArtifactStore::dirPath(const QByteArray &checksum) const
+{
+    return filePath(checksum) + DIR_SUFFIX;
+}
+
+void ArtifactStore::touch(const QString &path)
+{
+    // Directory timestamps are tracked through the marker file
+    const auto isDir = QFileInfo(path).isDir();
+    QFile file(isDir ? QDir(path).absoluteFilePath(EXTRACTED_MARKER) : path);
+
+    if(!file.exists() || !file.open(QIODevice::ReadWrite)) {
+        return;
+    }
+
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+}
+
+void ArtifactStore::evict()
+{
+    auto entries = m_root.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+
+    const auto lastUsed = [](const QFileInfo &fileInfo) {
+        return fileInfo.isDir() ? QFileInfo(QDir(fileInfo.absoluteFilePath()).absoluteFilePath(EXTRACTED_MARKER)).lastModified() :
+                                  fileInfo.lastModified();
+    };
+
+    // Most recently used first
+    std::sort(entries.begin(), entries.end(), [&](const QFileInfo &a, const QFileInfo &b) {
+        return lastUsed(a) > lastUsed(b);
+    });
+
+    const auto cutoff = QDateTime::currentDateTime().addSecs(-INCOMPLETE_MAX_AGE_SECS);
+    qint64 totalSize = 0;
+
+    for(const auto &entry : qAsConst(entries)) {
+        // Already removed along with its artifact
+        if(!QFileInfo::exists(entry.absoluteFilePath())) {
+            continue;
+        }
+
+        if(entry.isDir() && !lastUsed(entry).isValid()) {
+            const auto checksum = entry.fileName().chopped(DIR_SUFFIX.size()).toLatin1();
+            const auto isInProgress = m_activeExtractions.contains(checksum) && (entry.lastModified() > cutoff);
+
+            if(!isInProgress) {
+                qCDebug(LOG_ARTIFACTS).noquote() << "Removing incomplete extraction" << entry.fileName();
+                QDir(entry.absoluteFilePath()).removeRecursively();
+            }
+
+            continue;
+        }
+
+        // Still being written into
+        if(entry.fileName().endsWith(PARTIAL_SUFFIX) && m_activeDownloads.contains(entry.completeBaseName().toLatin1())) {
+            continue;
+        }
+
+        totalSize += entrySize(entry);
+
+        if(totalSize <= MAX_SIZE) {
+            continue;
+        }
+
+        qCDebug(LOG_ARTIFACTS).noquote() << "Evicting" << entry.fileName();
+
+        if(entry.isDir()) {
+            QDir(entry.absoluteFilePath()).removeRecursively();
+            continue;
+        }
+
+        QFile::remove(entry.absoluteFilePath());
+
+        // Derived files (<sha256>.tar, <sha256>.idx) are of no use without the artifact
+        if(!entry.fileName().contains(QLatin1Char('.'))) {
+            const auto derivedFileNames = m_root.entryList({entry.fileName() + QStringLiteral(".*")}, QDir::Files);
+
+            for(const auto &fileName : derivedFileNames) {
+                qCDebug(LOG_ARTIFACTS).noquote() << "Evicting" << fileName;
+                QFile::remove(m_root.absoluteFilePath(fileName));
+            }
+        }
+    }
+}
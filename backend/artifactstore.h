@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QDir>
+#include <QSet>
+#include <QMutex>
+#include <QByteArray>
+
+class QFile;
+class QObject;
+
+/*
+ * Persistent, size-bounded store for downloaded artifacts.
+ *
+ * Files are addressed by their sha256 checksum and stored as <sha256>, while
+ * their extracted contents (if any) live in a <sha256>.d directory next to them.
+ * Derived files, such as an inflated <sha256>.tar or a <sha256>.idx tar index, are stored
+ * under a suffixed key and are evicted along with their artifact.
+ * When the total size exceeds 2 GiB, the least recently used entries are evicted.
+ * Incomplete <sha256>.d directories are removed as soon as no extraction is writing
+ * into them, or once they are too old to belong to a live extraction.
+ * Interrupted downloads are kept as <sha256>.part, so they can be resumed later on.
+ */
+
+class ArtifactStore
+{
+    ArtifactStore();
+
+public:
+    static ArtifactStore *instance();
+
+    QDir root() const;
+
+    // Returns the stored file with the given checksum (marking it as recently used), or nullptr
+    QFile *file(const QByteArray &checksum, QObject *parent = nullptr);
+    // Moves a verified file into the store. Returns the stored file or nullptr on failure
+    QFile *insert(const QByteArray &checksum, QFile *file, QObject *parent = nullptr);
+
+    // Directory path for extracted contents of the given artifact, created if necessary
+    const QString extractPath(const QByteArray &checksum);
+    bool isExtracted(const QByteArray &checksum);
+
+    // Claims the extraction directory, returns false if another extraction is already writing into it
+    bool beginExtraction(const QByteArray &checksum);
+    // Marks the contents as complete on success, otherwise leaves them to eviction
+    void endExtraction(const QByteArray &checksum, bool isComplete);
+
+    // Claims the partial download file (possibly left over from an earlier run),
+    // returns nullptr if another download is already writing into it.
+    // The claim is released when the returned file is destroyed.
+    QFile *partialFile(const QByteArray &checksum, QObject *parent = nullptr);
+
+    bool isStored(const QFile *file) const;
+
+private:
+    const QString filePath(const QByteArray &checksum) const;
+    const QString dirPath(const QByteArray &checksum) const;
+
+    void touch(const QString &path);
+    void evict();
+
+    QDir m_root;
+    QSet<QByteArray> m_activeExtractions;
+    QSet<QByteArray> m_activeDownloads;
+    mutable QMutex m_mutex;
+};
+
+#define globalArtifactStore (ArtifactStore::instance())
@@ -14,10 +14,12 @@ SOURCES += \
     abstractoperationrunner.cpp \
     abstractserialoperation.cpp \
     applicationbackend.cpp \
+    artifactstore.cpp \
     deviceregistry.cpp \
     failable.cpp \
     filenode.cpp \
     firmwareupdateregistry.cpp \
+    fleetmanager.cpp \
     flipperupdates.cpp \
     flipperzero/assetmanifest.cpp \
     flipperzero/filemanager.cpp \
@@ -49,6 +51,7 @@ SOURCES += \
     flipperzero/rpc/systemrebootoperation.cpp \
     flipperzero/rpc/systemsetdatetimeoperation.cpp \
     flipperzero/rpc/skipmotdoperation.cpp \
+    flipperzero/deviceinfocache.cpp \
     flipperzero/devicestate.cpp \
     flipperzero/factoryinfo.cpp \
     flipperzero/flipperzero.cpp \
@@ -67,7 +70,12 @@ SOURCES += \
     flipperzero/recovery/setbootmodeoperation.cpp \
     flipperzero/recovery/wirelessstackdownloadoperation.cpp \
     flipperzero/recoveryinterface.cpp \
+    flipperzero/recoveryscheduler.cpp \
     flipperzero/rpc/systemupdateoperation.cpp \
+    flipperzero/screenframerenderer.cpp \
+    flipperzero/screenplayer.cpp \
+    flipperzero/screenrecorder.cpp \
+    flipperzero/screenrecording.cpp \
     flipperzero/screenstreamer.cpp \
     flipperzero/toplevel/abstracttopleveloperation.cpp \
     flipperzero/toplevel/factoryresetoperation.cpp \
@@ -101,6 +109,9 @@ SOURCES += \
     preferences.cpp \
     regioninfo.cpp \
     remotefilefetcher.cpp \
+    resourcescheduler.cpp \
+    screenframeconverter.cpp \
+    seekablegzipfile.cpp \
     serialfinder.cpp \
     simpleserialoperation.cpp \
     tararchive.cpp \
@@ -118,12 +129,14 @@ HEADERS += \
     abstractprotobufmessage.h \
     abstractserialoperation.h \
     applicationbackend.h \
+    artifactstore.h \
     backenderror.h \
     deviceregistry.h \
     failable.h \
     fileinfo.h \
     filenode.h \
     firmwareupdateregistry.h \
+    fleetmanager.h \
     flipperupdates.h \
     flipperzero/assetmanifest.h \
     flipperzero/devicecolor.h \
@@ -161,6 +174,7 @@ HEADERS += \
     flipperzero/rpc/systemsetdatetimeoperation.h \
     flipperzero/rpc/skipmotdoperation.h \
     flipperzero/deviceinfo.h \
+    flipperzero/deviceinfocache.h \
     flipperzero/devicestate.h \
     flipperzero/factoryinfo.h \
     flipperzero/flipperzero.h \
@@ -179,7 +193,12 @@ HEADERS += \
     flipperzero/recovery/setbootmodeoperation.h \
     flipperzero/recovery/wirelessstackdownloadoperation.h \
     flipperzero/recoveryinterface.h \
+    flipperzero/recoveryscheduler.h \
     flipperzero/rpc/systemupdateoperation.h \
+    flipperzero/screenframerenderer.h \
+    flipperzero/screenplayer.h \
+    flipperzero/screenrecorder.h \
+    flipperzero/screenrecording.h \
     flipperzero/screenstreamer.h \
     flipperzero/toplevel/abstracttopleveloperation.h \
     flipperzero/toplevel/factoryresetoperation.h \
@@ -214,7 +233,10 @@ HEADERS += \
     preferences.h \
     regioninfo.h \
     remotefilefetcher.h \
+    resourcescheduler.h \
     screenframe.h \
+    screenframeconverter.h \
+    seekablegzipfile.h \
     serialfinder.h \
     simpleserialoperation.h \
     tararchive.h \
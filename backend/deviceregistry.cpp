@@ -5,6 +5,7 @@
 #include <QLoggingCategory>
 
 #include "serialdevice/helper/deviceinfohelper.h"
+#include "serialdevice/deviceinfocache.h"
 #include "serialdevice/flipperzero.h"
 #include "serialdevice/devicestate.h"
 
@@ -45,6 +46,16 @@ SerialDevice *DeviceRegistry::currentDevice() const
     return m_devices.isEmpty() ? nullptr : m_devices.first();
 }
 
+const DeviceRegistry::DeviceList &DeviceRegistry::devices() const
+{
+    return m_devices;
+}
+
+const DeviceRegistry::PendingList &DeviceRegistry::pendingDevices() const
+{
+    return m_pendingDevices;
+}
+
 int DeviceRegistry::deviceCount() const
 {
     return m_devices.size();
@@ -86,11 +97,25 @@ void DeviceRegistry::insertDevice(const USBDeviceInfo &info)
         auto *fetcher = Zero::AbstractDeviceInfoHelper::create(info, this);
         connect(fetcher, &Zero::AbstractDeviceInfoHelper::finished, this, &DeviceRegistry::processDevice);
         connect(fetcher, &Zero::AbstractDeviceInfoHelper::finished, fetcher, &QObject::deleteLater);
+
+        Zero::DeviceInfo cachedInfo({});
+
+        // Show a known device right away, the probe will fill in the up-to-date information
+        if(globalDeviceInfoCache->load(info.serialNumber(), cachedInfo)) {
+            qCDebug(LOG_DEVREG).noquote() << "Known device:" << cachedInfo.name;
+
+            cachedInfo.usbInfo = info;
+            m_pendingDevices.append(cachedInfo);
+
+            emit pendingDevicesChanged();
+        }
     }
 }
 
 void DeviceRegistry::removeDevice(const USBDeviceInfo &info)
 {
+    removePendingDevice(info);
+
     const auto it = std::find_if(m_devices.begin(), m_devices.end(), [&](Flipper::SerialDevice *dev) {
         const auto &deviceInfo = dev->deviceState()->deviceInfo().usbInfo;
         return deviceInfo.backendData() == info.backendData();
@@ -140,12 +165,16 @@ void DeviceRegistry::processDevice()
     auto *fetcher = qobject_cast<Zero::AbstractDeviceInfoHelper*>(sender());
     const auto &info = fetcher->result();
 
+    removePendingDevice(info.usbInfo);
+
     if(fetcher->isError()) {
         qCDebug(LOG_DEVREG).noquote() << "Device initialization failed:" << fetcher->errorString();
         setError(fetcher->error());
         return;
     }
 
+    globalDeviceInfoCache->store(info);
+
     const auto it = std::find_if(m_devices.begin(), m_devices.end(), [&info](Flipper::SerialDevice *arg) {
         return info.name == arg->deviceState()->name();
     });
@@ -169,6 +198,18 @@ void DeviceRegistry::processDevice()
     }
 }
 
+void DeviceRegistry::removePendingDevice(const USBDeviceInfo &info)
+{
+    const auto it = std::find_if(m_pendingDevices.cbegin(), m_pendingDevices.cend(), [&info](const Zero::DeviceInfo &arg) {
+        return arg.usbInfo.backendData() == info.backendData();
+    });
+
+    if(it != m_pendingDevices.cend()) {
+        m_pendingDevices.erase(it);
+        emit pendingDevicesChanged();
+    }
+}
+
 void DeviceRegistry::setError(BackendError::ErrorType newError)
 {
     if(m_error == newError) {
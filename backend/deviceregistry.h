@@ -5,6 +5,7 @@
 
 #include "backenderror.h"
 #include "usbdeviceinfo.h"
+#include "serialdevice/deviceinfo.h"
 
 class USBDeviceDetector;
 
@@ -16,14 +17,18 @@ class DeviceRegistry : public QObject
 {
     Q_OBJECT
 
+public:
     using DeviceList = QVector<SerialDevice*>;
+    using PendingList = QVector<Zero::DeviceInfo>;
 
-public:
     DeviceRegistry(QObject *parent = nullptr);
 
     void setBackendLogLevel(int logLevel);
 
     SerialDevice *currentDevice() const;
+    const DeviceList &devices() const;
+    // Known devices that are still being probed, with their cached information
+    const PendingList &pendingDevices() const;
     int deviceCount() const;
 
     BackendError::ErrorType error() const;
@@ -35,6 +40,7 @@ signals:
     void isQueryInProgressChanged();
     void currentDeviceChanged();
     void deviceCountChanged();
+    void pendingDevicesChanged();
     void errorOccured();
 
 public slots:
@@ -48,9 +54,11 @@ private slots:
 private:
     void setError(BackendError::ErrorType newError);
     void setQueryInProgress(bool set);
+    void removePendingDevice(const USBDeviceInfo &info);
 
     USBDeviceDetector *m_detector;
     DeviceList m_devices;
+    PendingList m_pendingDevices;
     BackendError::ErrorType m_error;
     bool m_isQueryInProgress;
 };
@@ -0,0 +1,495 @@
+#include "fleetmanager.h"
+
+#include <algorithm>
+
+#include <QDir>
+#include <QUrl>
+#include <QTimer>
+#include <QDateTime>
+#include <QDebug>
+#include <QLoggingCategory>
+
+#include "deviceregistry.h"
+#include "updateregistry.h"
+
+#include "serialdevice/flipperzero.h"
+#include "serialdevice/devicestate.h"
+#include "serialdevice/helper/toplevelhelper.h"
+
+Q_LOGGING_CATEGORY(LOG_FLEET, "FLT")
+
+#define ELAPSED_UPDATE_INTERVAL_MS 1000
+#define PROGRESS_RATE_SMOOTHING 0.3
+
+using namespace Flipper;
+using namespace Zero;
+
+FleetManager::FleetManager(DeviceRegistry *deviceRegistry, UpdateRegistry *updateRegistry, QObject *parent):
+    QAbstractListModel(parent),
+    m_deviceRegistry(deviceRegistry),
+    m_updateRegistry(updateRegistry),
+    m_elapsedTimer(new QTimer(this)),
+    m_isRunning(false)
+{
+    m_elapsedTimer->setInterval(ELAPSED_UPDATE_INTERVAL_MS);
+
+    connect(m_elapsedTimer, &QTimer::timeout, this, &FleetManager::onElapsedTimerTimeout);
+    connect(m_deviceRegistry, &DeviceRegistry::deviceCountChanged, this, &FleetManager::onDeviceListChanged);
+    connect(m_deviceRegistry, &DeviceRegistry::pendingDevicesChanged, this, &FleetManager::onDeviceListChanged);
+
+    onDeviceListChanged();
+}
+
+bool FleetManager::isRunning() const
+{
+    return m_isRunning;
+}
+
+int FleetManager::finishedCount() const
+{
+    return std::count_if(m_jobs.cbegin(), m_jobs.cend(), [](const Job &job) {
+        return job.state == JobState::Finished;
+    });
+}
+
+int FleetManager::failedCount() const
+{
+    return std::count_if(m_jobs.cbegin(), m_jobs.cend(), [](const Job &job) {
+        return job.state == JobState::ErrorOccured;
+    });
+}
+
+double FleetManager::totalProgress() const
+{
+    auto jobCount = 0;
+    auto progress = 0.0;
+
+    for(const auto &job : m_jobs) {
+        if(job.state == JobState::Running) {
+            // Negative progress means indeterminate
+            progress += qBound(0.0, job.lastProgress, 100.0);
+        } else if(job.state == JobState::Finished || job.state == JobState::ErrorOccured) {
+            progress += 100.0;
+        } else {
+            continue;
+        }
+
+        ++jobCount;
+    }
+
+    return jobCount ? progress / jobCount : 0;
+}
+
+void FleetManager::updateAll()
+{
+    startAll([this](SerialDevice *device) {
+        AbstractOperationHelper *helper;
+
+        if(device->deviceState()->isRecoveryMode()) {
+            helper = new RepairTopLevelHelper(m_updateRegistry, device, this);
+        } else {
+            helper = new UpdateTopLevelHelper(m_updateRegistry, device, this);
+        }
+
+        connect(helper, &AbstractOperationHelper::finished, helper, &QObject::deleteLater);
+        return true;
+    });
+}
+
+void FleetManager::repairAll()
+{
+    startAll([this](SerialDevice *device) {
+        if(!device->deviceState()->isRecoveryMode()) {
+            return false;
+        }
+
+        auto *helper = new RepairTopLevelHelper(m_updateRegistry, device, this);
+        connect(helper, &AbstractOperationHelper::finished, helper, &QObject::deleteLater);
+
+        return true;
+    });
+}
+
+void FleetManager::backupAll(const QUrl &directoryUrl)
+{
+    const QDir backupDir(directoryUrl.toLocalFile());
+
+    if(!backupDir.exists() && !backupDir.mkpath(QStringLiteral("."))) {
+        qCDebug(LOG_FLEET) << "Failed to create the backup directory:" << backupDir.absolutePath();
+        return;
+    }
+
+    const auto timestamp = QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-hhmmss"));
+
+    startAll([&](SerialDevice *device) {
+        if(device->deviceState()->isRecoveryMode()) {
+            return false;
+        }
+
+        const auto fileName = QStringLiteral("%1-%2.tgz").arg(device->deviceState()->name(), timestamp);
+        device->createBackup(QUrl::fromLocalFile(backupDir.absoluteFilePath(fileName)));
+
+        return true;
+    });
+}
+
+void FleetManager::installFirmwareAll(const QUrl &fileUrl)
+{
+    startAll([&](SerialDevice *device) {
+        device->installFirmware(fileUrl);
+        return true;
+    });
+}
+
+int FleetManager::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return m_jobs.size();
+}
+
+QVariant FleetManager::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() >= m_jobs.size()) {
+        return QVariant();
+    }
+
+    const auto &job = m_jobs.at(index.row());
+
+    if(!job.device) {
+        const auto isLost = isLostJob(job);
+
+        switch(role) {
+        case NameRole:
+            return job.pendingInfo.name;
+        case StatusStringRole:
+            return isLost ? tr("Disconnected") : tr("Connecting...");
+        case ErrorStringRole:
+            return isLost ? tr("The device was disconnected during the operation") : QString();
+        case ProgressRole:
+            return -1.0;
+        case ElapsedRole:
+            return job.elapsed;
+        case JobStateRole:
+            return QVariant::fromValue(job.state);
+        default:
+            return QVariant();
+        }
+    }
+
+    const auto *state = job.device->deviceState();
+
+    switch(role) {
+    case NameRole:
+        return state->name();
+    case StatusStringRole:
+        return state->statusString();
+    case ErrorStringRole:
+        return state->errorString();
+    case ProgressRole:
+        return state->progress();
+    case ProgressRateRole:
+        return job.progressRate;
+    case ElapsedRole:
+        return job.state == JobState::Running ? job.timer.elapsed() : job.elapsed;
+    case JobStateRole:
+        return QVariant::fromValue(job.state);
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> FleetManager::roleNames() const
+{
+    static const QHash<int, QByteArray> roles = {
+        { NameRole, QByteArrayLiteral("name") },
+        { StatusStringRole, QByteArrayLiteral("statusString") },
+        { ErrorStringRole, QByteArrayLiteral("errorString") },
+        { ProgressRole, QByteArrayLiteral("progress") },
+        { ProgressRateRole, QByteArrayLiteral("progressRate") },
+        { ElapsedRole, QByteArrayLiteral("elapsed") },
+        { JobStateRole, QByteArrayLiteral("jobState") }
+    };
+
+    return roles;
+}
+
+void FleetManager::onDeviceListChanged()
+{
+    beginResetModel();
+
+    JobList jobs;
+    const auto &devices = m_deviceRegistry->devices();
+    const auto &pendingDevices = m_deviceRegistry->pendingDevices();
+
+    for(auto *device : devices) {
+        const auto it = std::find_if(m_jobs.cbegin(), m_jobs.cend(), [device](const Job &job) {
+            return job.device == device;
+        });
+
+        if(it != m_jobs.cend()) {
+            jobs.append(*it);
+            continue;
+        }
+
+        Job job({});
+        job.device = device;
+        job.state = JobState::Idle;
+        job.elapsed = 0;
+        job.lastSampleTime = 0;
+        job.lastProgress = 0;
+        job.progressRate = 0;
+
+        const auto *state = device->deviceState();
+
+        connect(state, &DeviceState::statusStringChanged, this, &FleetManager::onDeviceStateChanged, Qt::UniqueConnection);
+        connect(state, &DeviceState::isErrorChanged, this, &FleetManager::onDeviceStateChanged, Qt::UniqueConnection);
+        connect(state, &DeviceState::deviceInfoChanged, this, &FleetManager::onDeviceStateChanged, Qt::UniqueConnection);
+        connect(state, &DeviceState::progressChanged, this, &FleetManager::onDeviceProgressChanged, Qt::UniqueConnection);
+
+        jobs.append(job);
+    }
+
+    for(const auto &info : pendingDevices) {
+        const auto isRegistered = std::any_of(devices.cbegin(), devices.cend(), [&info](SerialDevice *device) {
+            return device->deviceState()->name() == info.name;
+        });
+
+        // Known devices going back online already have their row
+        if(isRegistered) {
+            continue;
+        }
+
+        Job job({});
+        job.device = nullptr;
+        job.pendingInfo = info;
+        job.state = JobState::Idle;
+
+        jobs.append(job);
+    }
+
+    // Devices gone mid-operation keep their row and count as failed
+    for(const auto &job : qAsConst(m_jobs)) {
+        if(isLostJob(job)) {
+            jobs.append(job);
+            continue;
+
+        } else if(job.state != JobState::Running || devices.contains(job.device)) {
+            continue;
+        }
+
+        Job lostJob(job);
+        lostJob.device = nullptr;
+        lostJob.pendingInfo = job.device->deviceState()->deviceInfo();
+        lostJob.pendingInfo.name = job.device->deviceState()->name();
+        lostJob.state = JobState::ErrorOccured;
+        lostJob.elapsed = job.timer.elapsed();
+        lostJob.progressRate = 0;
+
+        qCDebug(LOG_FLEET).noquote() << lostJob.pendingInfo.name << "was lost during the fleet operation";
+
+        jobs.append(lostJob);
+    }
+
+    m_jobs.swap(jobs);
+
+    endResetModel();
+
+    emit progressChanged();
+    checkFinished();
+}
+
+void FleetManager::onDeviceStateChanged()
+{
+    const auto row = indexOf(sender());
+
+    if(row >= 0) {
+        emitRowChanged(row, {NameRole, StatusStringRole, ErrorStringRole});
+    }
+}
+
+void FleetManager::onDeviceProgressChanged()
+{
+    const auto row = indexOf(sender());
+
+    if(row < 0) {
+        return;
+    }
+
+    auto &job = m_jobs[row];
+    const auto progress = job.device->deviceState()->progress();
+
+    if(job.state == JobState::Running) {
+        const auto now = job.timer.elapsed();
+        const auto dt = now - job.lastSampleTime;
+
+        // Progress restarts from zero on each stage, start sampling anew then
+        if(progress < job.lastProgress || progress < 0) {
+            job.progressRate = 0;
+
+        } else if(dt > 0) {
+            const auto rate = (progress - job.lastProgress) * 1000.0 / dt;
+            job.progressRate += (rate - job.progressRate) * PROGRESS_RATE_SMOOTHING;
+        }
+
+        job.lastSampleTime = now;
+    }
+
+    job.lastProgress = progress;
+    emitRowChanged(row, {ProgressRole, ProgressRateRole});
+
+    if(m_isRunning) {
+        emit progressChanged();
+    }
+}
+
+void FleetManager::onDeviceOperationFinished()
+{
+    const auto row = indexOf(sender());
+
+    if(row < 0) {
+        return;
+    }
+
+    auto &job = m_jobs[row];
+
+    if(job.state != JobState::Running) {
+        return;
+    }
+
+    disconnect(job.device, &SerialDevice::operationFinished, this, &FleetManager::onDeviceOperationFinished);
+    finishJob(job);
+
+    emitRowChanged(row);
+    emit progressChanged();
+
+    checkFinished();
+}
+
+void FleetManager::onElapsedTimerTimeout()
+{
+    for(auto i = 0; i < m_jobs.size(); ++i) {
+        if(m_jobs.at(i).state == JobState::Running) {
+            emitRowChanged(i, {ElapsedRole});
+        }
+    }
+}
+
+void FleetManager::startAll(const JobStarter &starter)
+{
+    if(m_isRunning) {
+        qCDebug(LOG_FLEET) << "Another fleet operation is already in progress";
+        return;
+    }
+
+    // The lost devices of the previous fleet operation are of no interest anymore
+    if(std::any_of(m_jobs.cbegin(), m_jobs.cend(), isLostJob)) {
+        beginResetModel();
+        m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(), isLostJob), m_jobs.end());
+        endResetModel();
+    }
+
+    auto startedCount = 0;
+
+    for(auto i = 0; i < m_jobs.size(); ++i) {
+        auto &job = m_jobs[i];
+        auto *device = job.device;
+
+        if(!device || !device->deviceState()->isOnline()) {
+            continue;
+        }
+
+        // Clear the leftovers of the previous fleet operation
+        if(job.state == JobState::Finished || job.state == JobState::ErrorOccured) {
+            device->finalizeOperation();
+        }
+
+        connect(device, &SerialDevice::operationFinished, this, &FleetManager::onDeviceOperationFinished, Qt::UniqueConnection);
+
+        job.state = JobState::Running;
+        job.elapsed = 0;
+        job.lastSampleTime = 0;
+        job.lastProgress = 0;
+        job.progressRate = 0;
+        job.timer.start();
+
+        if(!starter(device)) {
+            disconnect(device, &SerialDevice::operationFinished, this, &FleetManager::onDeviceOperationFinished);
+            job.state = JobState::Idle;
+            continue;
+        }
+
+        ++startedCount;
+        emitRowChanged(i);
+    }
+
+    if(!startedCount) {
+        qCDebug(LOG_FLEET) << "No suitable devices for the fleet operation";
+        return;
+    }
+
+    qCDebug(LOG_FLEET) << "Started fleet operation on" << startedCount << "device(s)";
+
+    m_isRunning = true;
+    m_elapsedTimer->start();
+
+    emit isRunningChanged();
+    emit progressChanged();
+}
+
+void FleetManager::finishJob(Job &job)
+{
+    const auto *state = job.device->deviceState();
+
+    job.state = state->isError() ? JobState::ErrorOccured : JobState::Finished;
+    job.elapsed = job.timer.elapsed();
+    job.progressRate = 0;
+
+    if(job.state == JobState::ErrorOccured) {
+        qCDebug(LOG_FLEET).noquote() << state->name() << "failed:" << state->errorString();
+    } else {
+        qCDebug(LOG_FLEET).noquote() << state->name() << "finished in" << job.elapsed << "ms";
+    }
+}
+
+void FleetManager::checkFinished()
+{
+    if(!m_isRunning) {
+        return;
+    }
+
+    const auto isRunning = std::any_of(m_jobs.cbegin(), m_jobs.cend(), [](const Job &job) {
+        return job.state == JobState::Running;
+    });
+
+    if(isRunning) {
+        return;
+    }
+
+    qCDebug(LOG_FLEET) << "Fleet operation finished:" << finishedCount() << "succeeded," << failedCount() << "failed";
+
+    m_isRunning = false;
+    m_elapsedTimer->stop();
+
+    emit isRunningChanged();
+    emit fleetOperationFinished();
+}
+
+bool FleetManager::isLostJob(const Job &job)
+{
+    return !job.device && job.state == JobState::ErrorOccured;
+}
+
+int FleetManager::indexOf(const QObject *deviceOrState) const
+{
+    const auto it = std::find_if(m_jobs.cbegin(), m_jobs.cend(), [deviceOrState](const Job &job) {
+        return job.device && (job.device == deviceOrState || job.device->deviceState() == deviceOrState);
+    });
+
+    return it == m_jobs.cend() ? -1 : std::distance(m_jobs.cbegin(), it);
+}
+
+void FleetManager::emitRowChanged(int row, const QVector<int> &roles)
+{
+    const auto idx = index(row);
+    emit dataChanged(idx, idx, roles);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <functional>
+
+#include <QVector>
+#include <QElapsedTimer>
+#include <QAbstractListModel>
+
+#include "serialdevice/deviceinfo.h"
+
+class QTimer;
+
+namespace Flipper {
+
+class SerialDevice;
+class DeviceRegistry;
+class UpdateRegistry;
+
+/* Runs the same top-level operation on every connected device at once.
+ * Each device keeps its own operation queue, the shared resources
+ * (network, extraction) are arbitrated by the ResourceScheduler,
+ * the blocking DFU work runs on the RecoveryScheduler thread pool. */
+
+class FleetManager : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(bool isRunning READ isRunning NOTIFY isRunningChanged)
+    Q_PROPERTY(int finishedCount READ finishedCount NOTIFY progressChanged)
+    Q_PROPERTY(int failedCount READ failedCount NOTIFY progressChanged)
+    Q_PROPERTY(double totalProgress READ totalProgress NOTIFY progressChanged)
+
+    enum DataRole {
+        NameRole = Qt::UserRole + 1,
+        StatusStringRole,
+        ErrorStringRole,
+        ProgressRole,
+        ProgressRateRole,
+        ElapsedRole,
+        JobStateRole
+    };
+
+public:
+    enum class JobState {
+        Idle,
+        Running,
+        Finished,
+        ErrorOccured
+    };
+
+    Q_ENUM(JobState)
+
+    FleetManager(DeviceRegistry *deviceRegistry, UpdateRegistry *updateRegistry, QObject *parent = nullptr);
+
+    bool isRunning() const;
+    int finishedCount() const;
+    int failedCount() const;
+    // Average progress of the current fleet operation, 0-100
+    double totalProgress() const;
+
+    Q_INVOKABLE void updateAll();
+    Q_INVOKABLE void repairAll();
+    Q_INVOKABLE void backupAll(const QUrl &directoryUrl);
+    Q_INVOKABLE void installFirmwareAll(const QUrl &fileUrl);
+
+    // Model API functions
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void isRunningChanged();
+    void progressChanged();
+    void fleetOperationFinished();
+
+private slots:
+    void onDeviceListChanged();
+    void onDeviceStateChanged();
+    void onDeviceProgressChanged();
+    void onDeviceOperationFinished();
+    void onElapsedTimerTimeout();
+
+private:
+    struct Job {
+        // Null for known devices that are still being probed,
+        // and for devices lost during a fleet operation
+        SerialDevice *device;
+        Zero::DeviceInfo pendingInfo;
+        JobState state;
+        QElapsedTimer timer;
+        qint64 elapsed;
+        qint64 lastSampleTime;
+        double lastProgress;
+        double progressRate;
+    };
+
+    using JobList = QVector<Job>;
+    using JobStarter = std::function<bool(SerialDevice*)>;
+
+    void startAll(const JobStarter &starter);
+    void finishJob(Job &job);
+    void checkFinished();
+
+    static bool isLostJob(const Job &job);
+
+    int indexOf(const QObject *deviceOrState) const;
+    void emitRowChanged(int row, const QVector<int> &roles = QVector<int>());
+
+    DeviceRegistry *m_deviceRegistry;
+    UpdateRegistry *m_updateRegistry;
+    QTimer *m_elapsedTimer;
+    JobList m_jobs;
+    bool m_isRunning;
+};
+
+}
@@ -1,16 +1,56 @@
 #include "remotefilefetcher.h"
 
+#include <QTimer>
+#include <QBuffer>
+#include <QFileDevice>
 #include <QNetworkAccessManager>
-#include <QCryptographicHash>
+#include <QLoggingCategory>
 #include <QNetworkReply>
 
 #include "debug.h"
 
+Q_LOGGING_CATEGORY(LOG_FETCHER, "NET")
+
+#define DEFAULT_MAX_RETRY_COUNT 5
+#define RETRY_BASE_DELAY_MS 500
+#define RETRY_MAX_DELAY_MS 16000
+#define RESUME_CHUNK_SIZE (1024 * 1024)
+
 using namespace Flipper;
 
+static bool isTransientError(QNetworkReply::NetworkError error)
+{
+    switch(error) {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::UnknownNetworkError:
+    case QNetworkReply::ProxyConnectionClosedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::ServiceUnavailableError:
+    case QNetworkReply::UnknownServerError:
+        return true;
+    default:
+        return false;
+    }
+}
+
 RemoteFileFetcher::RemoteFileFetcher(QObject *parent):
     QObject(parent),
-    m_manager(new QNetworkAccessManager(this))
+    m_manager(new QNetworkAccessManager(this)),
+    m_outputFile(nullptr),
+    m_hash(QCryptographicHash::Sha256),
+    m_isNotModified(false),
+    m_bytesReceived(0),
+    m_resumeOffset(0),
+    m_totalSize(-1),
+    m_retryCount(0),
+    m_maxRetryCount(DEFAULT_MAX_RETRY_COUNT),
+    m_isReplyChecked(false),
+    m_isReplyAccepted(false),
+    m_isRestartPending(false)
 {}
 
 RemoteFileFetcher::RemoteFileFetcher(const QString &remoteUrl, QIODevice *outputFile, QObject *parent):
@@ -27,66 +67,336 @@ RemoteFileFetcher::RemoteFileFetcher(const Flipper::Updates::FileInfo &fileInfo,
 
 bool RemoteFileFetcher::fetch(const QString &remoteUrl, QIODevice *outputFile)
 {
-    if(!outputFile->open(QIODevice::WriteOnly)) {
+    m_expectedChecksum.clear();
+    return beginFetch(remoteUrl, outputFile);
+}
+
+bool RemoteFileFetcher::fetch(const Flipper::Updates::FileInfo &fileInfo, QIODevice *outputFile)
+{
+    m_expectedChecksum = fileInfo.sha256();
+    return beginFetch(fileInfo.url(), outputFile);
+}
+
+bool RemoteFileFetcher::beginFetch(const QString &remoteUrl, QIODevice *outputFile)
+{
+    // Leftover data can only be verified against a known checksum, otherwise start from scratch
+    const auto isResumable = !m_expectedChecksum.isEmpty();
+
+    // Unlike WriteOnly, ReadWrite does not truncate the file
+    if(!outputFile->open(isResumable ? QIODevice::ReadWrite : QIODevice::WriteOnly)) {
         setError(BackendError::DiskError, QStringLiteral("Failed to open file for writing: %1.").arg(outputFile->errorString()));
         return false;
     }
 
-    auto *reply = m_manager->get(QNetworkRequest(remoteUrl));
+    m_remoteUrl = remoteUrl;
+    m_outputFile = outputFile;
 
-    if(reply->error() != QNetworkReply::NoError) {
-        setError(BackendError::InternetError, QStringLiteral("Network error: %1").arg(reply->errorString()));
+    m_isNotModified = false;
+    m_checksum.clear();
+    m_hash.reset();
+
+    m_bytesReceived = 0;
+    m_resumeOffset = 0;
+    m_totalSize = -1;
+    m_retryCount = 0;
 
-        reply->deleteLater();
+    if(isResumable && !seedFromOutput()) {
+        setError(BackendError::DiskError, QStringLiteral("Failed to read file: %1.").arg(outputFile->errorString()));
+        outputFile->close();
         return false;
     }
 
-    const auto onReplyReadyRead = [=]() {
-        outputFile->write(reply->readAll());
-    };
+    if(!m_checksum.isEmpty()) {
+        qCDebug(LOG_FETCHER).noquote() << "File" << m_remoteUrl << "has already been downloaded";
 
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        // In case there was any leftover data
-        onReplyReadyRead();
+        m_totalSize = m_bytesReceived;
 
-        outputFile->close();
-        reply->deleteLater();
+        QTimer::singleShot(0, this, &RemoteFileFetcher::finishFetch);
+        return true;
+    }
+
+    sendRequest();
+    return true;
+}
+
+bool RemoteFileFetcher::seedFromOutput()
+{
+    if(!m_outputFile->seek(0)) {
+        return false;
+    }
+
+    // Separate from m_hash, which has to stay open for the rest of the data
+    QCryptographicHash prefixHash(QCryptographicHash::Sha256);
+
+    while(!m_outputFile->atEnd()) {
+        const auto data = m_outputFile->read(RESUME_CHUNK_SIZE);
+
+        if(data.isEmpty()) {
+            return false;
+        }
+
+        m_hash.addData(data);
+        prefixHash.addData(data);
+        m_bytesReceived += data.size();
+    }
+
+    if(m_bytesReceived > 0) {
+        qCDebug(LOG_FETCHER).noquote() << "Found" << m_bytesReceived << "bytes of" << m_remoteUrl << "from an earlier download";
+
+        // Complete already, nothing left to fetch
+        if(prefixHash.result().toHex() == m_expectedChecksum) {
+            m_checksum = m_expectedChecksum;
+        }
+    }
+
+    return true;
+}
+
+void RemoteFileFetcher::setCacheValidators(const QByteArray &eTag, const QByteArray &lastModified)
+{
+    m_eTag = eTag;
+    m_lastModified = lastModified;
+}
+
+const QByteArray &RemoteFileFetcher::eTag() const
+{
+    return m_eTag;
+}
+
+const QByteArray &RemoteFileFetcher::lastModified() const
+{
+    return m_lastModified;
+}
+
+bool RemoteFileFetcher::isNotModified() const
+{
+    return m_isNotModified;
+}
+
+const QByteArray &RemoteFileFetcher::checksum() const
+{
+    return m_checksum;
+}
+
+void RemoteFileFetcher::setMaxRetryCount(int count)
+{
+    m_maxRetryCount = count;
+}
+
+void RemoteFileFetcher::onDownloadProgress(qint64 received, qint64 total)
+{
+    if(total <= 0) {
+        return;
+    }
+
+    // Account for the data received before resuming
+    emit progressChanged(((double)(m_resumeOffset + received) / (double)(m_resumeOffset + total)) * 100.0);
+}
+
+void RemoteFileFetcher::sendRequest()
+{
+    QNetworkRequest request(m_remoteUrl);
 
-        if(reply->error() != QNetworkReply::NoError) {
-            setError(BackendError::InternetError, QStringLiteral("Network error: %1").arg(reply->errorString()));
+    m_resumeOffset = m_bytesReceived;
 
-        } else if(!m_expectedChecksum.isEmpty()) {
-            if(!outputFile->open(QIODevice::ReadOnly)) {
-                setError(BackendError::DiskError, QStringLiteral("Failed to open file for reading: %1.").arg(outputFile->errorString()));
+    if(m_resumeOffset > 0) {
+        request.setRawHeader(QByteArrayLiteral("Range"), QByteArrayLiteral("bytes=") + QByteArray::number(m_resumeOffset) + '-');
+
+        // The server will send the whole file again if it has changed in between
+        if(!m_eTag.isEmpty()) {
+            request.setRawHeader(QByteArrayLiteral("If-Range"), m_eTag);
+        } else if(!m_lastModified.isEmpty()) {
+            request.setRawHeader(QByteArrayLiteral("If-Range"), m_lastModified);
+        }
+
+    } else {
+        if(!m_eTag.isEmpty()) {
+            request.setRawHeader(QByteArrayLiteral("If-None-Match"), m_eTag);
+        }
+
+        if(!m_lastModified.isEmpty()) {
+            request.setRawHeader(QByteArrayLiteral("If-Modified-Since"), m_lastModified);
+        }
+    }
+
+    m_isReplyChecked = false;
+    m_isReplyAccepted = false;
+    m_isRestartPending = false;
+
+    auto *reply = m_manager->get(request);
+
+    const auto onReplyReadyRead = [=]() {
+        if(!m_isReplyChecked) {
+            m_isReplyChecked = true;
+            m_isReplyAccepted = beginPartialContent(reply);
+
+            if(isError() || m_isRestartPending) {
+                reply->abort();
                 return;
             }
+        }
 
-            QCryptographicHash hash(QCryptographicHash::Sha256);
-            hash.addData(outputFile);
+        const auto data = reply->readAll();
 
-            if(hash.result().toHex() != m_expectedChecksum) {
-                setError(BackendError::UnknownError, QStringLiteral("File integrity check failed"));
-            }
+        // Error pages must not end up in the file, onReplyFinished() decides what happens next
+        if(!m_isReplyAccepted) {
+            return;
+        }
+
+        if(m_outputFile->write(data) != data.size()) {
+            setError(BackendError::DiskError, QStringLiteral("Failed to write to file: %1").arg(m_outputFile->errorString()));
+            reply->abort();
+            return;
+        }
+
+        m_hash.addData(data);
+        m_bytesReceived += data.size();
+    };
 
-            outputFile->close();
+    connect(reply, &QNetworkReply::finished, this, [=]() {
+        // In case there was any leftover data
+        if(reply->error() == QNetworkReply::NoError) {
+            onReplyReadyRead();
         }
 
-        emit finished();
+        onReplyFinished(reply);
     });
 
     connect(reply, &QNetworkReply::readyRead, this, onReplyReadyRead);
     connect(reply, &QNetworkReply::downloadProgress, this, &RemoteFileFetcher::onDownloadProgress);
+}
+
+bool RemoteFileFetcher::beginPartialContent(QNetworkReply *reply)
+{
+    const auto statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if(statusCode == 206) {
+        // Content-Range: bytes <first>-<last>/<total>
+        const auto contentRange = reply->rawHeader(QByteArrayLiteral("Content-Range"));
+        const auto first = contentRange.mid(contentRange.indexOf(' ') + 1, contentRange.indexOf('-') - contentRange.indexOf(' ') - 1).toLongLong();
+        const auto total = contentRange.mid(contentRange.indexOf('/') + 1).toLongLong();
+
+        if(first != m_resumeOffset || (m_totalSize >= 0 && total != m_totalSize)) {
+            qCWarning(LOG_FETCHER).noquote() << "Unexpected content range:" << contentRange << "- starting over";
+
+            if(!restartOutput()) {
+                setError(BackendError::DiskError, QStringLiteral("Failed to truncate file: %1").arg(m_outputFile->errorString()));
+            } else {
+                m_isRestartPending = true;
+            }
+
+            return false;
+
+        } else if(m_totalSize < 0) {
+            m_totalSize = total;
+        }
+
+        qCDebug(LOG_FETCHER).noquote() << "Resuming download of" << m_remoteUrl << "from" << m_resumeOffset << "bytes";
+        return true;
+
+    } else if(statusCode != 200) {
+        // 304 has no body, anything else is an error page (416 included)
+        return false;
+    }
+
+    // Whole file is being sent, either initially or because the resource has changed
+    if(m_resumeOffset > 0 && !restartOutput()) {
+        setError(BackendError::DiskError, QStringLiteral("Failed to truncate file: %1").arg(m_outputFile->errorString()));
+        return false;
+    }
+
+    m_eTag = reply->rawHeader(QByteArrayLiteral("ETag"));
+    m_lastModified = reply->rawHeader(QByteArrayLiteral("Last-Modified"));
+
+    const auto contentLength = reply->header(QNetworkRequest::ContentLengthHeader);
+    m_totalSize = contentLength.isValid() ? contentLength.toLongLong() : -1;
 
     return true;
 }
 
-bool RemoteFileFetcher::fetch(const Flipper::Updates::FileInfo &fileInfo, QIODevice *outputFile)
+bool RemoteFileFetcher::restartOutput()
 {
-    m_expectedChecksum = fileInfo.sha256();
-    return fetch(fileInfo.url(), outputFile);
+    auto *fileDevice = qobject_cast<QFileDevice*>(m_outputFile);
+    auto *buffer = qobject_cast<QBuffer*>(m_outputFile);
+
+    if(fileDevice && !fileDevice->resize(0)) {
+        return false;
+    } else if(buffer) {
+        buffer->buffer().clear();
+    }
+
+    m_hash.reset();
+    m_bytesReceived = 0;
+    m_resumeOffset = 0;
+
+    return m_outputFile->seek(0);
 }
 
-void RemoteFileFetcher::onDownloadProgress(qint64 received, qint64 total)
+void RemoteFileFetcher::onReplyFinished(QNetworkReply *reply)
+{
+    reply->deleteLater();
+
+    const auto error = reply->error();
+    const auto statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if(isError()) {
+        finishFetch();
+        return;
+
+    } else if(statusCode == 416 && m_resumeOffset > 0 && m_retryCount < m_maxRetryCount) {
+        // The data left over from an earlier run is longer than the file
+        qCWarning(LOG_FETCHER).noquote() << "Cannot resume download of" << m_remoteUrl << "from" << m_resumeOffset << "bytes - starting over";
+
+        if(!restartOutput()) {
+            setError(BackendError::DiskError, QStringLiteral("Failed to truncate file: %1").arg(m_outputFile->errorString()));
+            finishFetch();
+            return;
+        }
+
+        ++m_retryCount;
+        sendRequest();
+        return;
+
+    } else if(m_isRestartPending && m_retryCount < m_maxRetryCount) {
+        ++m_retryCount;
+        sendRequest();
+        return;
+
+    } else if(error != QNetworkReply::NoError) {
+        if(isTransientError(error) && m_retryCount < m_maxRetryCount) {
+            const auto delay = qMin(RETRY_BASE_DELAY_MS << m_retryCount, RETRY_MAX_DELAY_MS);
+            ++m_retryCount;
+
+            qCWarning(LOG_FETCHER).noquote() << "Transfer interrupted:" << reply->errorString() << "- retrying in" << delay << "ms, attempt" << m_retryCount;
+
+            QTimer::singleShot(delay, this, &RemoteFileFetcher::sendRequest);
+            return;
+        }
+
+        setError(BackendError::InternetError, QStringLiteral("Network error: %1").arg(reply->errorString()));
+        finishFetch();
+        return;
+    }
+
+    m_isNotModified = statusCode == 304;
+    m_checksum = m_hash.result().toHex();
+
+    if(m_isNotModified) {
+        finishFetch();
+        return;
+
+    } else if(m_totalSize >= 0 && m_bytesReceived != m_totalSize) {
+        setError(BackendError::InternetError, QStringLiteral("Incomplete transfer: got %1 of %2 bytes").arg(m_bytesReceived).arg(m_totalSize));
+
+    } else if(!m_expectedChecksum.isEmpty() && (m_checksum != m_expectedChecksum)) {
+        setError(BackendError::UnknownError, QStringLiteral("File integrity check failed"));
+    }
+
+    finishFetch();
+}
+
+void RemoteFileFetcher::finishFetch()
 {
-    emit progressChanged(((double)received / (double)total) * 100.0);
+    m_outputFile->close();
+    emit finished();
 }
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <QObject>
+#include <QCryptographicHash>
 
 #include "failable.h"
 #include "flipperupdates.h"
 
+class QNetworkReply;
 class QNetworkAccessManager;
 
 class RemoteFileFetcher : public QObject, public Failable
@@ -17,8 +19,23 @@ public:
     RemoteFileFetcher(const Flipper::Updates::FileInfo &fileInfo, QIODevice *outputFile, QObject *parent = nullptr);
 
     bool fetch(const QString &remoteUrl, QIODevice *outputFile);
+    // The checksum makes the data already present in outputFile trustworthy,
+    // so a download interrupted in an earlier run is resumed rather than restarted
     bool fetch(const Flipper::Updates::FileInfo &fileInfo, QIODevice *outputFile);
 
+    // Make the next fetch conditional (If-None-Match / If-Modified-Since)
+    void setCacheValidators(const QByteArray &eTag, const QByteArray &lastModified);
+
+    const QByteArray &eTag() const;
+    const QByteArray &lastModified() const;
+    bool isNotModified() const;
+
+    // Hex-encoded sha256 of the downloaded data, computed as it arrives
+    const QByteArray &checksum() const;
+
+    // Number of times a dropped transfer may be resumed before giving up
+    void setMaxRetryCount(int count);
+
 signals:
     void progressChanged(double);
     void finished();
@@ -27,6 +44,31 @@ private slots:
     void onDownloadProgress(qint64 received, qint64 total);
 
 private:
+    bool beginFetch(const QString &remoteUrl, QIODevice *outputFile);
+    bool seedFromOutput();
+    void sendRequest();
+    void onReplyFinished(QNetworkReply *reply);
+    // Returns whether the reply body is file data
+    bool beginPartialContent(QNetworkReply *reply);
+    bool restartOutput();
+    void finishFetch();
+
     QNetworkAccessManager *m_manager;
+    QString m_remoteUrl;
+    QIODevice *m_outputFile;
     QByteArray m_expectedChecksum;
+    QByteArray m_checksum;
+    QCryptographicHash m_hash;
+    QByteArray m_eTag;
+    QByteArray m_lastModified;
+    bool m_isNotModified;
+
+    qint64 m_bytesReceived;
+    qint64 m_resumeOffset;
+    qint64 m_totalSize;
+    int m_retryCount;
+    int m_maxRetryCount;
+    bool m_isReplyChecked;
+    bool m_isReplyAccepted;
+    bool m_isRestartPending;
 };
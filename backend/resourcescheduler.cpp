@@ -0,0 +1,99 @@
+#include "resourcescheduler.h"
+
+#include <QTimer>
+#include <QThread>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(LOG_SCHEDULER, "SCH")
+
+#define DEFAULT_NETWORK_LIMIT 2
+
+ResourceScheduler::ResourceScheduler():
+    QObject()
+{
+    m_pools[(int)Resource::Network].limit = DEFAULT_NETWORK_LIMIT;
+    m_pools[(int)Resource::Extraction].limit = qMax(1, QThread::idealThreadCount() / 2);
+}
+
+ResourceScheduler *ResourceScheduler::instance()
+{
+    static ResourceScheduler instance;
+    return &instance;
+}
+
+int ResourceScheduler::limit(Resource resource) const
+{
+    return m_pools.value((int)resource).limit;
+}
+
+void ResourceScheduler::setLimit(Resource resource, int limit)
+{
+    m_pools[(int)resource].limit = qMax(1, limit);
+    dispatch(resource);
+}
+
+void ResourceScheduler::acquire(Resource resource, QObject *holder, const std::function<void()> &callback)
+{
+    auto &pool = m_pools[(int)resource];
+
+    connect(holder, &QObject::destroyed, this, &ResourceScheduler::onHolderDestroyed, Qt::UniqueConnection);
+
+    if(pool.holders.contains(holder)) {
+        // Already holding a slot
+        callback();
+
+    } else if(pool.holders.size() < pool.limit && pool.queue.isEmpty()) {
+        pool.holders.append(holder);
+        callback();
+
+    } else {
+        qCDebug(LOG_SCHEDULER) << resource << "limit reached, queueing request," << pool.queue.size() << "already waiting";
+        pool.queue.enqueue({holder, callback});
+    }
+}
+
+void ResourceScheduler::release(Resource resource, QObject *holder)
+{
+    auto &pool = m_pools[(int)resource];
+
+    // Also cancel the request if it is still waiting
+    for(auto it = pool.queue.begin(); it != pool.queue.end();) {
+        if(it->holder == holder) {
+            it = pool.queue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if(pool.holders.removeOne(holder)) {
+        dispatch(resource);
+    }
+}
+
+void ResourceScheduler::onHolderDestroyed(QObject *holder)
+{
+    for(auto it = m_pools.begin(); it != m_pools.end(); ++it) {
+        if(it->holders.removeOne(holder)) {
+            dispatch((Resource)it.key());
+        }
+    }
+}
+
+void ResourceScheduler::dispatch(Resource resource)
+{
+    auto &pool = m_pools[(int)resource];
+
+    while(pool.holders.size() < pool.limit && !pool.queue.isEmpty()) {
+        const auto request = pool.queue.dequeue();
+
+        // The requesting object was destroyed while waiting
+        if(request.holder.isNull()) {
+            continue;
+        }
+
+        pool.holders.append(request.holder.data());
+
+        // Do not call back from within release() or a destructor
+        QTimer::singleShot(0, request.holder.data(), request.callback);
+    }
+}
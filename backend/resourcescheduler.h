@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QQueue>
+#include <QObject>
+#include <QPointer>
+
+#include <functional>
+
+/*
+ * Caps the number of concurrently running resource-heavy jobs (network fetches,
+ * archive extraction) across all devices. Jobs over the limit wait in a queue.
+ * A slot is held until released or until its holder object is destroyed.
+ */
+
+class ResourceScheduler : public QObject
+{
+    Q_OBJECT
+
+    ResourceScheduler();
+
+public:
+    enum class Resource {
+        Network,
+        Extraction
+    };
+
+    Q_ENUM(Resource)
+
+    static ResourceScheduler *instance();
+
+    int limit(Resource resource) const;
+    void setLimit(Resource resource, int limit);
+
+    // Calls the callback as soon as a slot is available (immediately if possible)
+    void acquire(Resource resource, QObject *holder, const std::function<void()> &callback);
+    // Frees the slot held by the holder or cancels its pending request
+    void release(Resource resource, QObject *holder);
+
+private slots:
+    void onHolderDestroyed(QObject *holder);
+
+private:
+    struct Request {
+        QPointer<QObject> holder;
+        std::function<void()> callback;
+    };
+
+    struct Pool {
+        int limit;
+        QList<QObject*> holders;
+        QQueue<Request> queue;
+    };
+
+    void dispatch(Resource resource);
+
+    QHash<int, Pool> m_pools;
+};
+
+#define globalResourceScheduler (ResourceScheduler::instance())
@@ -3,11 +3,16 @@
 #include <QMetaType>
 #include <QByteArray>
 #include <QSize>
+#include <QRect>
 
 struct ScreenFrame {
     QByteArray pixelData;
     QSize size;
     Qt::ScreenOrientation orientation;
+
+    // Area changed since the previous frame, in unrotated pixel coordinates.
+    // An invalid rectangle means the whole frame must be repainted.
+    QRect dirtyRect;
 };
 
 Q_DECLARE_METATYPE(ScreenFrame)
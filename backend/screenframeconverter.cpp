@@ -0,0 +1,128 @@
+#include "screenframeconverter.h"
+
+#include <cstdint>
+
+// Transpose an 8x8 bit matrix where bit (8 * row + col) holds element [row][col]
+static inline uint64_t transpose8x8(uint64_t x)
+{
+    uint64_t t;
+
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x = x ^ t ^ (t << 28);
+
+    return x;
+}
+
+static inline uint64_t loadBlock(const uint8_t *in, int stride)
+{
+    uint64_t x = 0;
+
+    for(auto i = 0; i < 8; ++i) {
+        x |= (uint64_t)in[i * stride] << (8 * i);
+    }
+
+    return x;
+}
+
+static inline void storeBlock(uint64_t x, uint8_t *out, int stride)
+{
+    for(auto i = 0; i < 8; ++i) {
+        out[i * stride] = (uint8_t)(x >> (8 * i));
+    }
+}
+
+static inline bool isBlockAligned(const QByteArray &in, int width, int height)
+{
+    return (width > 0) && (height > 0) && (width % 8 == 0) && (height % 8 == 0) && (in.size() >= (width * height) / 8);
+}
+
+QByteArray ScreenFrameConverter::toScreenStream(const QByteArray &in, int width, int height)
+{
+    if(!isBlockAligned(in, width, height)) {
+        return toScreenStreamGeneric(in, width, height);
+    }
+
+    QByteArray out((width * height) / 8, Qt::Uninitialized);
+
+    const auto *src = (const uint8_t*)in.constData();
+    auto *dst = (uint8_t*)out.data();
+
+    const auto rowStride = width / 8;
+
+    // Input block: 8 rows of one byte each, output block: 8 consecutive column bytes
+    for(auto page = 0; page < height / 8; ++page) {
+        for(auto col = 0; col < rowStride; ++col) {
+            const auto x = loadBlock(src + page * 8 * rowStride + col, rowStride);
+            storeBlock(transpose8x8(x), dst + page * width + col * 8, 1);
+        }
+    }
+
+    return out;
+}
+
+QByteArray ScreenFrameConverter::toVirtualDisplay(const QByteArray &in, int width, int height)
+{
+    if(!isBlockAligned(in, width, height)) {
+        return toVirtualDisplayGeneric(in, width, height);
+    }
+
+    QByteArray out((width * height) / 8, Qt::Uninitialized);
+
+    const auto *src = (const uint8_t*)in.constData();
+    auto *dst = (uint8_t*)out.data();
+
+    const auto rowStride = width / 8;
+
+    for(auto page = 0; page < height / 8; ++page) {
+        for(auto col = 0; col < rowStride; ++col) {
+            const auto x = loadBlock(src + page * width + col * 8, 1);
+            storeBlock(transpose8x8(x), dst + page * 8 * rowStride + col, rowStride);
+        }
+    }
+
+    return out;
+}
+
+QByteArray ScreenFrameConverter::toScreenStreamGeneric(const QByteArray &in, int width, int height)
+{
+    QByteArray out((width * height) / 8, 0x0);
+
+    for(auto y = 0; y < height; ++y) {
+        for(auto x = 0; x < width; ++x) {
+            const auto ii = (y * width + x) / 8;
+            const auto oi = y / 8 * width + x;
+
+            if(ii >= in.size() || oi >= out.size()) {
+                continue;
+            } else if(in.at(ii) & (1 << (x % 8))) {
+                out[oi] = out.at(oi) | (1 << (y % 8));
+            }
+        }
+    }
+
+    return out;
+}
+
+QByteArray ScreenFrameConverter::toVirtualDisplayGeneric(const QByteArray &in, int width, int height)
+{
+    QByteArray out((width * height) / 8, 0x0);
+
+    for(auto y = 0; y < height; ++y) {
+        for(auto x = 0; x < width; ++x) {
+            const auto ii = y / 8 * width + x;
+            const auto oi = (y * width + x) / 8;
+
+            if(ii >= in.size() || oi >= out.size()) {
+                continue;
+            } else if(in.at(ii) & (1 << (y % 8))) {
+                out[oi] = out.at(oi) | (1 << (x % 8));
+            }
+        }
+    }
+
+    return out;
+}
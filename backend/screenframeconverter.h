@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QByteArray>
+
+/*
+ * Converts 1bpp images between the two layouts used by the device:
+ *
+ * - VirtualDisplay (XBM): row-major, 8 horizontal pixels per byte, LSB = leftmost pixel
+ * - ScreenStream: 8-row pages, 8 vertical pixels per byte, LSB = topmost pixel
+ *
+ * Each 8x8 pixel block is a bit matrix transpose, which is done with word-level
+ * operations on a 64-bit integer. Images with dimensions not divisible by 8
+ * fall back to the per-pixel conversion.
+ */
+
+class ScreenFrameConverter
+{
+public:
+    static QByteArray toScreenStream(const QByteArray &in, int width, int height);
+    static QByteArray toVirtualDisplay(const QByteArray &in, int width, int height);
+
+    // Per-pixel reference implementations, used for unaligned images
+    // and to check the block transpose against
+    static QByteArray toScreenStreamGeneric(const QByteArray &in, int width, int height);
+    static QByteArray toVirtualDisplayGeneric(const QByteArray &in, int width, int height);
+};
@@ -0,0 +1,254 @@
+#include "seekablegzipfile.h"
+
+#include <QtEndian>
+#include <QLoggingCategory>
+
+#include <zlib.h>
+
+Q_DECLARE_LOGGING_CATEGORY(LOG_UNZIP)
+
+#define GZIP_HEADER_SIZE 12
+#define GZIP_TRAILER_SIZE 8
+#define GZIP_FLAG_FEXTRA 0x04
+
+#define SUBFIELD_HEADER_SIZE 4
+
+static int readBlockSize(QFile &file, qint64 offset)
+{
+    uchar header[GZIP_HEADER_SIZE];
+
+    if(!file.seek(offset) || file.read((char*)header, GZIP_HEADER_SIZE) != GZIP_HEADER_SIZE) {
+        return -1;
+    } else if(header[0] != 0x1f || header[1] != 0x8b || header[2] != Z_DEFLATED || !(header[3] & GZIP_FLAG_FEXTRA)) {
+        return -1;
+    }
+
+    const auto extraSize = qFromLittleEndian<quint16>(header + 10);
+    const auto extra = file.read(extraSize);
+
+    if(extra.size() != extraSize) {
+        return -1;
+    }
+
+    const auto *p = (const uchar*)extra.constData();
+
+    for(int i = 0; i + SUBFIELD_HEADER_SIZE <= extraSize;) {
+        const auto subfieldSize = qFromLittleEndian<quint16>(p + i + 2);
+
+        if(p[i] == 'B' && p[i + 1] == 'C' && subfieldSize == 2 && i + SUBFIELD_HEADER_SIZE + 2 <= extraSize) {
+            return qFromLittleEndian<quint16>(p + i + SUBFIELD_HEADER_SIZE) + 1;
+        }
+
+        i += SUBFIELD_HEADER_SIZE + subfieldSize;
+    }
+
+    return -1;
+}
+
+SeekableGZipFile::SeekableGZipFile(const QString &fileName, QObject *parent):
+    QIODevice(parent),
+    m_file(fileName),
+    m_currentBlock(-1),
+    m_devicePos(0)
+{}
+
+SeekableGZipFile::~SeekableGZipFile()
+{}
+
+bool SeekableGZipFile::isSeekable(const QString &fileName)
+{
+    QFile file(fileName);
+
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    return readBlockSize(file, 0) > 0;
+}
+
+bool SeekableGZipFile::open(OpenMode mode)
+{
+    if(mode & QIODevice::WriteOnly) {
+        setErrorString(QStringLiteral("Writing is not supported"));
+        return false;
+
+    } else if(!m_file.open(QIODevice::ReadOnly)) {
+        setErrorString(m_file.errorString());
+        return false;
+
+    } else if(!buildBlockTable()) {
+        m_file.close();
+        return false;
+    }
+
+    m_currentBlock = -1;
+    m_devicePos = 0;
+
+    // Unbuffered, as blocks are cached internally anyway
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void SeekableGZipFile::close()
+{
+    QIODevice::close();
+
+    m_file.close();
+    m_blocks.clear();
+    m_blockData.clear();
+    m_currentBlock = -1;
+}
+
+bool SeekableGZipFile::isSequential() const
+{
+    return false;
+}
+
+qint64 SeekableGZipFile::size() const
+{
+    if(m_blocks.isEmpty()) {
+        return 0;
+    }
+
+    const auto &lastBlock = m_blocks.last();
+    return lastBlock.uncompressedOffset + lastBlock.uncompressedSize;
+}
+
+bool SeekableGZipFile::seek(qint64 pos)
+{
+    if(pos < 0 || pos > size()) {
+        return false;
+    }
+
+    m_devicePos = pos;
+    return QIODevice::seek(pos);
+}
+
+qint64 SeekableGZipFile::readData(char *data, qint64 maxSize)
+{
+    qint64 bytesRead = 0;
+
+    while(bytesRead < maxSize && m_devicePos < size()) {
+        const auto blockIndex = findBlock(m_devicePos);
+
+        if(blockIndex < 0 || !loadBlock(blockIndex)) {
+            return bytesRead ? bytesRead : -1;
+        }
+
+        const auto &block = m_blocks.at(blockIndex);
+        const auto blockPos = m_devicePos - block.uncompressedOffset;
+        const auto n = qMin(maxSize - bytesRead, block.uncompressedSize - blockPos);
+
+        memcpy(data + bytesRead, m_blockData.constData() + blockPos, n);
+
+        bytesRead += n;
+        m_devicePos += n;
+    }
+
+    return bytesRead;
+}
+
+qint64 SeekableGZipFile::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+
+    return -1;
+}
+
+bool SeekableGZipFile::buildBlockTable()
+{
+    m_blocks.clear();
+
+    qint64 compressedOffset = 0;
+    qint64 uncompressedOffset = 0;
+
+    const auto fileSize = m_file.size();
+
+    while(compressedOffset < fileSize) {
+        const auto blockSize = readBlockSize(m_file, compressedOffset);
+
+        if(blockSize < GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE || compressedOffset + blockSize > fileSize) {
+            setErrorString(QStringLiteral("Malformed block at offset %1").arg(compressedOffset));
+            return false;
+        }
+
+        uchar sizeField[4];
+
+        if(!m_file.seek(compressedOffset + blockSize - 4) || m_file.read((char*)sizeField, 4) != 4) {
+            setErrorString(m_file.errorString());
+            return false;
+        }
+
+        const qint64 uncompressedSize = qFromLittleEndian<quint32>(sizeField);
+
+        // Skip empty blocks, such as the end-of-file marker
+        if(uncompressedSize) {
+            m_blocks.append({compressedOffset, blockSize, uncompressedOffset, uncompressedSize});
+        }
+
+        compressedOffset += blockSize;
+        uncompressedOffset += uncompressedSize;
+    }
+
+    qCDebug(LOG_UNZIP) << "Indexed" << m_blocks.size() << "gzip blocks," << uncompressedOffset << "bytes uncompressed";
+    return true;
+}
+
+bool SeekableGZipFile::loadBlock(int blockIndex)
+{
+    if(blockIndex == m_currentBlock) {
+        return true;
+    }
+
+    const auto &block = m_blocks.at(blockIndex);
+
+    if(!m_file.seek(block.compressedOffset)) {
+        setErrorString(m_file.errorString());
+        return false;
+    }
+
+    auto compressedData = m_file.read(block.compressedSize);
+
+    if(compressedData.size() != block.compressedSize) {
+        setErrorString(QStringLiteral("Archive file is truncated"));
+        return false;
+    }
+
+    m_currentBlock = -1;
+    m_blockData.resize(block.uncompressedSize);
+
+    z_stream stream = {};
+    stream.next_in = (Bytef*)compressedData.data();
+    stream.avail_in = compressedData.size();
+    stream.next_out = (Bytef*)m_blockData.data();
+    stream.avail_out = m_blockData.size();
+
+    if(inflateInit2(&stream, 15 + 16) != Z_OK) {
+        setErrorString(QStringLiteral("Failed to initialise deflate method"));
+        return false;
+    }
+
+    const auto err = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+
+    if(err != Z_STREAM_END || stream.avail_out) {
+        setErrorString(QStringLiteral("Error during uncompression"));
+        return false;
+    }
+
+    m_currentBlock = blockIndex;
+    return true;
+}
+
+int SeekableGZipFile::findBlock(qint64 pos) const
+{
+    const auto it = std::upper_bound(m_blocks.cbegin(), m_blocks.cend(), pos, [](qint64 pos, const Block &block) {
+        return pos < block.uncompressedOffset;
+    });
+
+    if(it == m_blocks.cbegin()) {
+        return -1;
+    }
+
+    return std::distance(m_blocks.cbegin(), it) - 1;
+}
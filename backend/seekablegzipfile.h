@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QFile>
+#include <QVector>
+#include <QIODevice>
+#include <QByteArray>
+
+/*
+ * Random-access reader for blocked gzip files.
+ *
+ * A blocked gzip file is a concatenation of independent gzip members, each
+ * carrying its own compressed size in a 'BC' FEXTRA subfield (the BGZF layout,
+ * as produced by `bgzip`). Such files are still valid gzip streams, but the
+ * member headers double as an embedded access-point index: the block table is
+ * built by hopping from header to header, and a read only inflates the blocks
+ * that overlap the requested range.
+ */
+
+class SeekableGZipFile : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    SeekableGZipFile(const QString &fileName, QObject *parent = nullptr);
+    ~SeekableGZipFile();
+
+    static bool isSeekable(const QString &fileName);
+
+    bool open(OpenMode mode) override;
+    void close() override;
+
+    bool isSequential() const override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    struct Block {
+        qint64 compressedOffset;
+        qint64 compressedSize;
+        qint64 uncompressedOffset;
+        qint64 uncompressedSize;
+    };
+
+    bool buildBlockTable();
+    bool loadBlock(int blockIndex);
+    int findBlock(qint64 pos) const;
+
+    QFile m_file;
+    QVector<Block> m_blocks;
+    QByteArray m_blockData;
+    int m_currentBlock;
+    qint64 m_devicePos;
+};
+
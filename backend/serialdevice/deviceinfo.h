@@ -88,6 +88,7 @@ struct DeviceInfo {
     Q_PROPERTY(Flipper::Serial::StorageInfo storage MEMBER storage)
 
     Q_PROPERTY(int stackType MEMBER stackType)
+    Q_PROPERTY(qint64 probeDuration MEMBER probeDuration)
 
 public:
     QString name;
@@ -103,6 +104,8 @@ public:
     StorageInfo storage;
 
     QString systemLocation;
+    // Time from plug-in to the device being ready, in milliseconds
+    qint64 probeDuration;
 
     USBDeviceInfo usbInfo;
     QSerialPortInfo portInfo;
@@ -0,0 +1,198 @@
+#include "deviceinfocache.h"
+
+#include <QFile>
+#include <QRegExp>
+#include <QSaveFile>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(LOG_DEVCACHE, "DIC")
+
+#define DEVICES_DIR_NAME QStringLiteral("devices")
+#define CACHE_FORMAT_VERSION 1
+
+using namespace Flipper;
+using namespace Zero;
+
+DeviceInfoCache::DeviceInfoCache():
+    m_root(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+{
+    if(!m_root.mkpath(DEVICES_DIR_NAME) || !m_root.cd(DEVICES_DIR_NAME)) {
+        qCWarning(LOG_DEVCACHE) << "Failed to create device cache directory";
+    }
+}
+
+DeviceInfoCache *DeviceInfoCache::instance()
+{
+    static DeviceInfoCache instance;
+    return &instance;
+}
+
+bool DeviceInfoCache::contains(const QString &serialNumber)
+{
+    return m_entries.contains(serialNumber) || QFile::exists(filePath(serialNumber));
+}
+
+bool DeviceInfoCache::load(const QString &serialNumber, DeviceInfo &info)
+{
+    if(serialNumber.isEmpty()) {
+        return false;
+    }
+
+    const auto it = m_entries.constFind(serialNumber);
+
+    if(it != m_entries.cend()) {
+        info = it.value();
+        return true;
+    }
+
+    QFile file(filePath(serialNumber));
+
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    DeviceInfo cached({});
+
+    if(!fromJson(file.readAll(), cached)) {
+        qCDebug(LOG_DEVCACHE) << "Discarding invalid cache entry for" << serialNumber;
+        file.remove();
+        return false;
+    }
+
+    m_entries.insert(serialNumber, cached);
+    info = cached;
+
+    return true;
+}
+
+void DeviceInfoCache::store(const DeviceInfo &info)
+{
+    const auto serialNumber = info.usbInfo.serialNumber();
+
+    if(serialNumber.isEmpty() || info.name.isEmpty()) {
+        return;
+    }
+
+    m_entries.insert(serialNumber, info);
+
+    const auto text = toJson(info);
+    QSaveFile file(filePath(serialNumber));
+
+    if(!file.open(QIODevice::WriteOnly) || (file.write(text) != text.size()) || !file.commit()) {
+        qCWarning(LOG_DEVCACHE).noquote() << "Failed to cache device information:" << file.errorString();
+    }
+}
+
+void DeviceInfoCache::remove(const QString &serialNumber)
+{
+    m_entries.remove(serialNumber);
+    QFile::remove(filePath(serialNumber));
+}
+
+const QString DeviceInfoCache::filePath(const QString &serialNumber) const
+{
+    // Serial numbers come from USB descriptors, do not let them escape the cache directory
+    auto fileName = serialNumber;
+    fileName.replace(QRegExp(QStringLiteral("[^A-Za-z0-9_.-]")), QStringLiteral("_"));
+
+    return m_root.absoluteFilePath(fileName + QStringLiteral(".json"));
+}
+
+const QByteArray DeviceInfoCache::toJson(const DeviceInfo &info)
+{
+    const QJsonObject hardware {
+        { QStringLiteral("version"), info.hardware.version },
+        { QStringLiteral("target"), info.hardware.target },
+        { QStringLiteral("body"), info.hardware.body },
+        { QStringLiteral("connect"), info.hardware.connect },
+        { QStringLiteral("color"), (int)info.hardware.color },
+        { QStringLiteral("region"), (int)info.hardware.region }
+    };
+
+    const QJsonObject firmware {
+        { QStringLiteral("version"), info.firmware.version },
+        { QStringLiteral("commit"), info.firmware.commit },
+        { QStringLiteral("branch"), info.firmware.branch },
+        { QStringLiteral("channel"), info.firmware.channel },
+        { QStringLiteral("date"), info.firmware.date.toString(Qt::ISODate) }
+    };
+
+    const QJsonObject storage {
+        { QStringLiteral("internalFree"), info.storage.internalFree },
+        { QStringLiteral("externalFree"), info.storage.externalFree },
+        { QStringLiteral("isExternalPresent"), info.storage.isExternalPresent },
+        { QStringLiteral("isAssetsInstalled"), info.storage.isAssetsInstalled }
+    };
+
+    const QJsonObject root {
+        { QStringLiteral("formatVersion"), CACHE_FORMAT_VERSION },
+        { QStringLiteral("name"), info.name },
+        { QStringLiteral("model"), info.model },
+        { QStringLiteral("hardware"), hardware },
+        { QStringLiteral("firmware"), firmware },
+        { QStringLiteral("storage"), storage },
+        { QStringLiteral("fusVersion"), info.fusVersion },
+        { QStringLiteral("radioVersion"), info.radioVersion },
+        { QStringLiteral("stackType"), info.stackType },
+        { QStringLiteral("protobufMajor"), (int)info.protobuf.versionMajor },
+        { QStringLiteral("protobufMinor"), (int)info.protobuf.versionMinor }
+    };
+
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool DeviceInfoCache::fromJson(const QByteArray &text, DeviceInfo &info)
+{
+    const auto doc = QJsonDocument::fromJson(text);
+
+    if(!doc.isObject()) {
+        return false;
+    }
+
+    const auto root = doc.object();
+
+    if(root.value(QStringLiteral("formatVersion")).toInt() != CACHE_FORMAT_VERSION) {
+        return false;
+    }
+
+    info.name = root.value(QStringLiteral("name")).toString();
+
+    if(info.name.isEmpty()) {
+        return false;
+    }
+
+    info.model = root.value(QStringLiteral("model")).toString();
+
+    const auto hardware = root.value(QStringLiteral("hardware")).toObject();
+    info.hardware.version = hardware.value(QStringLiteral("version")).toString();
+    info.hardware.target = hardware.value(QStringLiteral("target")).toString();
+    info.hardware.body = hardware.value(QStringLiteral("body")).toString();
+    info.hardware.connect = hardware.value(QStringLiteral("connect")).toString();
+    info.hardware.color = (Color)hardware.value(QStringLiteral("color")).toInt();
+    info.hardware.region = (Region)hardware.value(QStringLiteral("region")).toInt();
+
+    const auto firmware = root.value(QStringLiteral("firmware")).toObject();
+    info.firmware.version = firmware.value(QStringLiteral("version")).toString();
+    info.firmware.commit = firmware.value(QStringLiteral("commit")).toString();
+    info.firmware.branch = firmware.value(QStringLiteral("branch")).toString();
+    info.firmware.channel = firmware.value(QStringLiteral("channel")).toString();
+    info.firmware.date = QDate::fromString(firmware.value(QStringLiteral("date")).toString(), Qt::ISODate);
+
+    const auto storage = root.value(QStringLiteral("storage")).toObject();
+    info.storage.internalFree = storage.value(QStringLiteral("internalFree")).toInt();
+    info.storage.externalFree = storage.value(QStringLiteral("externalFree")).toInt();
+    info.storage.isExternalPresent = storage.value(QStringLiteral("isExternalPresent")).toBool();
+    info.storage.isAssetsInstalled = storage.value(QStringLiteral("isAssetsInstalled")).toBool();
+
+    info.fusVersion = root.value(QStringLiteral("fusVersion")).toString();
+    info.radioVersion = root.value(QStringLiteral("radioVersion")).toString();
+    info.stackType = root.value(QStringLiteral("stackType")).toInt();
+
+    info.protobuf.versionMajor = root.value(QStringLiteral("protobufMajor")).toInt();
+    info.protobuf.versionMinor = root.value(QStringLiteral("protobufMinor")).toInt();
+
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QDir>
+#include <QHash>
+#include <QString>
+
+#include "deviceinfo.h"
+
+namespace Flipper {
+namespace Zero {
+
+/*
+ * Persistent per-device snapshots of DeviceInfo, keyed by the USB serial number.
+ *
+ * The identity fields (name, hardware, region, color) never change for a given
+ * device, so a known device can be shown right away while it is being probed.
+ * The remaining fields are only the last known values and must be revalidated.
+ */
+
+class DeviceInfoCache
+{
+    DeviceInfoCache();
+
+public:
+    static DeviceInfoCache *instance();
+
+    bool contains(const QString &serialNumber);
+    // Fills in the cached snapshot, returns false if there is none
+    bool load(const QString &serialNumber, DeviceInfo &info);
+    void store(const DeviceInfo &info);
+    void remove(const QString &serialNumber);
+
+private:
+    const QString filePath(const QString &serialNumber) const;
+
+    static const QByteArray toJson(const DeviceInfo &info);
+    static bool fromJson(const QByteArray &text, DeviceInfo &info);
+
+    QDir m_root;
+    QHash<QString, DeviceInfo> m_entries;
+};
+
+}
+}
+
+#define globalDeviceInfoCache (Flipper::Zero::DeviceInfoCache::instance())
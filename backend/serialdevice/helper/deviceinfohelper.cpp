@@ -9,6 +9,7 @@
 #include <QLoggingCategory>
 
 #include "serialdevice/factoryinfo.h"
+#include "serialdevice/deviceinfocache.h"
 #include "serialdevice/protobufsession.h"
 
 #include "serialdevice/rpc/stoprpcoperation.h"
@@ -31,7 +32,9 @@ using namespace Zero;
 AbstractDeviceInfoHelper::AbstractDeviceInfoHelper(QObject *parent):
     AbstractOperationHelper(parent),
     m_deviceInfo({})
-{}
+{
+    m_probeTimer.start();
+}
 
 AbstractDeviceInfoHelper::~AbstractDeviceInfoHelper()
 {}
@@ -55,8 +58,19 @@ const DeviceInfo &AbstractDeviceInfoHelper::result() const
     return m_deviceInfo;
 }
 
+void AbstractDeviceInfoHelper::finishProbe()
+{
+    m_deviceInfo.probeDuration = m_probeTimer.elapsed();
+    qCDebug(CATEGORY_DEBUG).noquote() << "Device" << m_deviceInfo.name << "probed in" << m_deviceInfo.probeDuration << "ms";
+
+    finish();
+}
+
 VCPDeviceInfoHelper::VCPDeviceInfoHelper(const USBDeviceInfo &info, QObject *parent):
-    AbstractDeviceInfoHelper(parent)
+    AbstractDeviceInfoHelper(parent),
+    m_rpc(nullptr),
+    m_pendingQueryCount(0),
+    m_isManifestPresent(false)
 {
     m_deviceInfo.usbInfo = info;
 }
@@ -76,26 +90,10 @@ void VCPDeviceInfoHelper::nextStateLogic()
         fetchProtobufVersion();
 
     } else if(state() == VCPDeviceInfoHelper::FetchingProtobufVersion) {
-        setState(VCPDeviceInfoHelper::FetchingDeviceInfo);
-        fetchDeviceInfo();
-
-    } else if(state() == VCPDeviceInfoHelper::FetchingDeviceInfo) {
-        setState(VCPDeviceInfoHelper::CheckingSDCard);
-        checkSDCard();
-
-    } else if(state() == VCPDeviceInfoHelper::CheckingSDCard) {
-        setState(VCPDeviceInfoHelper::CheckingManifest);
-        checkManifest();
-
-    } else if(state() == VCPDeviceInfoHelper::CheckingManifest) {
-        setState(VCPDeviceInfoHelper::GettingTimeSkew);
-        getTimeSkew();
+        setState(VCPDeviceInfoHelper::QueryingDevice);
+        queryDevice();
 
-    } else if(state() == VCPDeviceInfoHelper::GettingTimeSkew) {
-        setState(VCPDeviceInfoHelper::SyncingTime);
-        syncTime();
-
-    } else if(state() == VCPDeviceInfoHelper::SyncingTime) {
+    } else if(state() == VCPDeviceInfoHelper::QueryingDevice) {
         setState(VCPDeviceInfoHelper::StoppingRPCSession);
         stopRPCSession();
     }
@@ -147,6 +145,21 @@ void VCPDeviceInfoHelper::fetchProtobufVersion()
     });
 }
 
+/* The queries below do not depend on each other, so they are all put
+ * into the session queue at once and joined in onQueryFinished().
+ * The manifest check goes last: it fails without an SD card, and a failed
+ * operation clears the rest of the session queue. */
+void VCPDeviceInfoHelper::queryDevice()
+{
+    m_pendingQueryCount = 5;
+
+    fetchDeviceInfo();
+    checkSDCard();
+    getTimeSkew();
+    syncTime();
+    checkManifest();
+}
+
 void VCPDeviceInfoHelper::fetchDeviceInfo()
 {
     const auto &protobuf = m_deviceInfo.protobuf;
@@ -164,7 +177,7 @@ void VCPDeviceInfoHelper::fetchDeviceInfoLegacy()
 
     connect(operation, &AbstractOperation::finished, this, [=]() {
         if(operation->isError()) {
-            finishWithError(BackendError::InvalidDevice, QStringLiteral("Failed to get device information: %1").arg(operation->errorString()));
+            onQueryFailed(QStringLiteral("Failed to get device information: %1").arg(operation->errorString()));
             return;
         }
 
@@ -202,9 +215,9 @@ void VCPDeviceInfoHelper::fetchDeviceInfoLegacy()
         }
 
         if(m_deviceInfo.name.isEmpty()) {
-            finishWithError(BackendError::InvalidDevice, QStringLiteral("Failed to read device information: required fields are not present"));
+            onQueryFailed(QStringLiteral("Failed to read device information: required fields are not present"));
         } else {
-            advanceState();
+            onQueryFinished();
         }
     });
 }
@@ -215,7 +228,7 @@ void VCPDeviceInfoHelper::fetchDeviceInfoProperty()
 
     connect(operation, &AbstractOperation::finished, this, [=]() {
         if(operation->isError()) {
-            finishWithError(BackendError::InvalidDevice, QStringLiteral("Failed to get device information: %1").arg(operation->errorString()));
+            onQueryFailed(QStringLiteral("Failed to get device information: %1").arg(operation->errorString()));
             return;
         }
 
@@ -253,9 +266,9 @@ void VCPDeviceInfoHelper::fetchDeviceInfoProperty()
         }
 
         if(m_deviceInfo.name.isEmpty()) {
-            finishWithError(BackendError::InvalidDevice, QStringLiteral("Failed to read device information: required fields are not present"));
+            onQueryFailed(QStringLiteral("Failed to read device information: required fields are not present"));
         } else {
-            advanceState();
+            onQueryFinished();
         }
     });
 }
@@ -266,20 +279,17 @@ void VCPDeviceInfoHelper::checkSDCard()
 
     connect(operation, &AbstractOperation::finished, this, [=]() {
         if(operation->isError()) {
-            finishWithError(BackendError::InvalidDevice, QStringLiteral("Failed to check SD card: %1").arg(operation->errorString()));
+            onQueryFailed(QStringLiteral("Failed to check SD card: %1").arg(operation->errorString()));
 
         } else if(!operation->isPresent()) {
             m_deviceInfo.storage.isExternalPresent = false;
-            m_deviceInfo.storage.isAssetsInstalled = false;
-
-            setState(VCPDeviceInfoHelper::CheckingManifest);
-            advanceState();
+            onQueryFinished();
 
         } else {
             m_deviceInfo.storage.isExternalPresent = true;
             m_deviceInfo.storage.externalFree = floor((double)operation->sizeFree() * 100.0 /
                                                       (double)operation->sizeTotal());
-            advanceState();
+            onQueryFinished();
         }
     });
 }
@@ -289,13 +299,14 @@ void VCPDeviceInfoHelper::checkManifest()
     auto *operation = m_rpc->storageStat(QByteArrayLiteral("/ext/Manifest"));
 
     connect(operation, &AbstractOperation::finished, this, [=]() {
+        // The result only matters if the SD card is present, which is not known yet
         if(operation->isError()) {
-            finishWithError(BackendError::InvalidDevice, QStringLiteral("Failed to check resource manifest: %1").arg(operation->errorString()));
-
+            m_manifestErrorString = QStringLiteral("Failed to check resource manifest: %1").arg(operation->errorString());
         } else {
-            m_deviceInfo.storage.isAssetsInstalled = operation->hasFile() && (operation->type() == StorageStatOperation::RegularFile);
-            advanceState();
+            m_isManifestPresent = operation->hasFile() && (operation->type() == StorageStatOperation::RegularFile);
         }
+
+        onQueryFinished();
     });
 }
 
@@ -305,13 +316,13 @@ void VCPDeviceInfoHelper::getTimeSkew()
 
     connect(operation, &AbstractOperation::finished, this, [=]() {
         if(operation->isError()) {
-            finishWithError(BackendError::InvalidDevice, QStringLiteral("Failed to check device time: %1").arg(operation->errorString()));
+            onQueryFailed(QStringLiteral("Failed to check device time: %1").arg(operation->errorString()));
 
         } else {
             const auto timeSkew = QDateTime::currentDateTime().msecsTo(operation->dateTime());
             qCDebug(CATEGORY_DEBUG) << "Flipper time skew is" << timeSkew << "milliseconds";
 
-            advanceState();
+            onQueryFinished();
         }
     });
 }
@@ -322,16 +333,43 @@ void VCPDeviceInfoHelper::syncTime()
 
     connect(operation, &AbstractOperation::finished, this, [=]() {
         if(operation->isError()) {
-            finishWithError(BackendError::InvalidDevice, QStringLiteral("Failed to set device time: %1").arg(operation->errorString()));
+            onQueryFailed(QStringLiteral("Failed to set device time: %1").arg(operation->errorString()));
         } else {
-            advanceState();
+            onQueryFinished();
         }
     });
 }
 
+/* The port stays in RPC mode, so that the SerialDevice session
+ * opened right after can skip the handshake. */
 void VCPDeviceInfoHelper::stopRPCSession()
 {
-    m_rpc->stopSession();
+    m_rpc->handOffSession();
+}
+
+void VCPDeviceInfoHelper::onQueryFinished()
+{
+    // Late results after a failed query are of no interest
+    if(state() != VCPDeviceInfoHelper::QueryingDevice || --m_pendingQueryCount) {
+        return;
+    }
+
+    auto &storage = m_deviceInfo.storage;
+
+    if(storage.isExternalPresent && !m_manifestErrorString.isEmpty()) {
+        finishWithError(BackendError::InvalidDevice, m_manifestErrorString);
+        return;
+    }
+
+    storage.isAssetsInstalled = storage.isExternalPresent && m_isManifestPresent;
+    advanceState();
+}
+
+void VCPDeviceInfoHelper::onQueryFailed(const QString &errorString)
+{
+    if(state() == VCPDeviceInfoHelper::QueryingDevice) {
+        finishWithError(BackendError::InvalidDevice, errorString);
+    }
 }
 
 void VCPDeviceInfoHelper::onSessionStatusChanged()
@@ -341,7 +379,7 @@ void VCPDeviceInfoHelper::onSessionStatusChanged()
     } else if(state() == VCPDeviceInfoHelper::StartingRPCSession && m_rpc->isSessionUp()) {
         advanceState();
     } else if(state() == VCPDeviceInfoHelper::StoppingRPCSession && !m_rpc->isSessionUp()) {
-        finish();
+        finishProbe();
     }
 }
 
@@ -383,18 +421,33 @@ void DFUDeviceInfoHelper::nextStateLogic()
 {
     STM32WB55 device(m_deviceInfo.usbInfo);
 
+    // Also serves as the access check, so it is done even when the information is cached
     if(!device.beginTransaction()) {
         finishWithError(BackendError::RecoveryAccessError, QStringLiteral("Failed to initiate transaction"));
         return;
     }
 
-    const FactoryInfo factoryInfo(device.OTPData(FactoryInfo::size()));
+    DeviceInfo cachedInfo({});
+
+    // Factory information is in OTP memory and never changes, no need to read it again
+    const auto isCached = globalDeviceInfoCache->load(m_deviceInfo.usbInfo.serialNumber(), cachedInfo);
+    const auto otpData = isCached ? QByteArray() : device.OTPData(FactoryInfo::size());
 
     if(!device.endTransaction()) {
         finishWithError(BackendError::RecoveryAccessError, QStringLiteral("Failed to end transaction"));
         return;
     }
 
+    if(isCached) {
+        m_deviceInfo.name = cachedInfo.name;
+        m_deviceInfo.hardware = cachedInfo.hardware;
+
+        finishProbe();
+        return;
+    }
+
+    const FactoryInfo factoryInfo(otpData);
+
     if(!factoryInfo.isValid()) {
         finishWithError(BackendError::InvalidDevice, QStringLiteral("Failed to read device factory information"));
         return;
@@ -408,5 +461,5 @@ void DFUDeviceInfoHelper::nextStateLogic()
     m_deviceInfo.hardware.color = factoryInfo.color();
     m_deviceInfo.hardware.region = factoryInfo.region();
 
-    finish();
+    finishProbe();
 }
@@ -2,6 +2,7 @@
 
 #include <QObject>
 #include <QByteArray>
+#include <QElapsedTimer>
 
 #include "abstractoperationhelper.h"
 #include "serialdevice/deviceinfo.h"
@@ -26,7 +27,12 @@ public:
     const DeviceInfo &result() const;
 
 protected:
+    void finishProbe();
+
     DeviceInfo m_deviceInfo;
+
+private:
+    QElapsedTimer m_probeTimer;
 };
 
 class VCPDeviceInfoHelper : public AbstractDeviceInfoHelper
@@ -37,11 +43,7 @@ class VCPDeviceInfoHelper : public AbstractDeviceInfoHelper
         FindingSerialPort = AbstractOperationHelper::User,
         StartingRPCSession,
         FetchingProtobufVersion,
-        FetchingDeviceInfo,
-        CheckingSDCard,
-        CheckingManifest,
-        GettingTimeSkew,
-        SyncingTime,
+        QueryingDevice,
         StoppingRPCSession
     };
 
@@ -54,6 +56,7 @@ private:
     void findSerialPort();
     void startRPCSession();
     void fetchProtobufVersion();
+    void queryDevice();
     void fetchDeviceInfo();
     void fetchDeviceInfoLegacy();
     void fetchDeviceInfoProperty();
@@ -63,12 +66,19 @@ private:
     void syncTime();
     void stopRPCSession();
 
+    void onQueryFinished();
+    void onQueryFailed(const QString &errorString);
+
 private slots:
     void onSessionStatusChanged();
 
 private:
     static const QString &branchToChannelName(const QByteArray &branchName);
     ProtobufSession *m_rpc;
+
+    int m_pendingQueryCount;
+    bool m_isManifestPresent;
+    QString m_manifestErrorString;
 };
 
 class DFUDeviceInfoHelper : public AbstractDeviceInfoHelper
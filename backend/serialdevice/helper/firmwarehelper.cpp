@@ -11,20 +11,34 @@
 
 #include "remotefilefetcher.h"
 #include "tempdirectories.h"
+#include "artifactstore.h"
+#include "resourcescheduler.h"
+
+#define MAX_CONCURRENT_FETCHES 3
+#define TOTAL_FILE_COUNT 6
 
 using namespace Flipper;
 using namespace Zero;
 
 FirmwareHelper::FirmwareHelper(DeviceState *deviceState, const Updates::VersionInfo &versionInfo, QObject *parent):
+    FirmwareHelper(deviceState, versionInfo, FetchMode::Concurrent, parent)
+{}
+
+FirmwareHelper::FirmwareHelper(DeviceState *deviceState, const Updates::VersionInfo &versionInfo, FetchMode fetchMode, QObject *parent):
     AbstractOperationHelper(parent),
     m_deviceState(deviceState),
-    m_versionInfo(versionInfo)
+    m_versionInfo(versionInfo),
+    m_fetchMode(fetchMode),
+    m_activeFetchCount(0),
+    m_hasRadioUpdate(false)
 {}
 
 FirmwareHelper::~FirmwareHelper()
 {
     for(const auto &file : qAsConst(m_files)) {
-        file->remove();
+        if(!globalArtifactStore->isStored(file)) {
+            file->remove();
+        }
     }
 
     m_files.clear();
@@ -42,9 +56,17 @@ bool FirmwareHelper::hasRadioUpdate() const
 
 void FirmwareHelper::nextStateLogic()
 {
-    if(state() == AbstractOperationHelper::Ready) {
+    if(state() == AbstractOperationHelper::Ready && m_fetchMode == FetchMode::Concurrent) {
+        setState(FirmwareHelper::FetchingConcurrently);
+        globalResourceScheduler->acquire(ResourceScheduler::Resource::Network, this, [=]() {
+            fetchAllConcurrently();
+        });
+
+    } else if(state() == AbstractOperationHelper::Ready) {
         setState(FirmwareHelper::FetchingFirmware);
-        fetchFirmware();
+        globalResourceScheduler->acquire(ResourceScheduler::Resource::Network, this, [=]() {
+            fetchFirmware();
+        });
 
     } else if(state() == FirmwareHelper::FetchingFirmware) {
         setState(FirmwareHelper::FetchingCore2Firmware);
@@ -67,6 +89,7 @@ void FirmwareHelper::nextStateLogic()
         fetchAssets();
 
     } else if(state() == FirmwareHelper::FetchingAssets) {
+        globalResourceScheduler->release(ResourceScheduler::Resource::Network, this);
         finish();
     }
 }
@@ -74,26 +97,26 @@ void FirmwareHelper::nextStateLogic()
 void FirmwareHelper::fetchFirmware()
 {
     m_deviceState->setStatusString(QStringLiteral("Fetching application firmware..."));
-    const auto &fileInfo = m_versionInfo.fileInfo(QStringLiteral("full_dfu"), m_deviceState->deviceInfo().hardware.target);
-    fetchFile(FileIndex::Firmware, fileInfo);
+    fetchFile(FileIndex::Firmware, remoteFileInfo(FileIndex::Firmware));
 }
 
 void FirmwareHelper::fetchCore2Firmware()
 {
     m_deviceState->setStatusString(QStringLiteral("Fetching radio firmware..."));
-    const auto &fileInfo = m_versionInfo.fileInfo(QStringLiteral("core2_firmware_tgz"), QStringLiteral("any"));
-    fetchFile(FileIndex::Core2Tgz, fileInfo);
+    fetchFile(FileIndex::Core2Tgz, remoteFileInfo(FileIndex::Core2Tgz));
 }
 
 void FirmwareHelper::prepareRadioFirmware()
 {
     m_deviceState->setStatusString(QStringLiteral("Preparing radio firmware..."));
-    auto *helper = new RadioManifestHelper(m_files[FileIndex::Core2Tgz], this);
+    auto *helper = new RadioManifestHelper(m_files[FileIndex::Core2Tgz], m_checksums[FileIndex::Core2Tgz], this);
 
     connect(helper, &AbstractOperationHelper::finished, this, [=]() {
         helper->deleteLater();
 
-        if(helper->isError()) {
+        if(state() == AbstractOperationHelper::Finished) {
+            return;
+        } else if(helper->isError()) {
             finishWithError(helper->error(), helper->errorString());
             return;
         }
@@ -119,26 +142,27 @@ void FirmwareHelper::prepareRadioFirmware()
             file->close();
         }
 
-        advanceState();
+        onFileReady(FileIndex::RadioFirmware);
     });
 }
 
 void FirmwareHelper::fetchScripts()
 {
     m_deviceState->setStatusString(QStringLiteral("Fetching scripts..."));
-    const auto &fileInfo = m_versionInfo.fileInfo(QStringLiteral("scripts_tgz"), QStringLiteral("any"));
-    fetchFile(FileIndex::ScriptsTgz, fileInfo);
+    fetchFile(FileIndex::ScriptsTgz, remoteFileInfo(FileIndex::ScriptsTgz));
 }
 
 void FirmwareHelper::prepareOptionBytes()
 {
     m_deviceState->setStatusString(QStringLiteral("Preparing scripts..."));
-    auto *helper = new ScriptsHelper(m_files[FileIndex::ScriptsTgz], this);
+    auto *helper = new ScriptsHelper(m_files[FileIndex::ScriptsTgz], m_checksums[FileIndex::ScriptsTgz], this);
 
     connect(helper, &AbstractOperationHelper::finished, this, [=]() {
         helper->deleteLater();
 
-        if(helper->isError()) {
+        if(state() == AbstractOperationHelper::Finished) {
+            return;
+        } else if(helper->isError()) {
             finishWithError(helper->error(), helper->errorString());
             return;
         }
@@ -152,7 +176,7 @@ void FirmwareHelper::prepareOptionBytes()
             finishWithError(BackendError::DiskError, QStringLiteral("Failed to write to temporary file: %1").arg(file->errorString()));
         } else {
             file->close();
-            advanceState();
+            onFileReady(FileIndex::OptionBytes);
         }
     });
 }
@@ -160,15 +184,53 @@ void FirmwareHelper::prepareOptionBytes()
 void FirmwareHelper::fetchAssets()
 {
     m_deviceState->setStatusString(QStringLiteral("Fetching databases..."));
+    fetchFile(FileIndex::AssetsTgz, remoteFileInfo(FileIndex::AssetsTgz));
+}
 
-    const auto type = QStringLiteral("resources_tgz");
-    auto fileInfo = m_versionInfo.fileInfo(type, m_deviceState->deviceInfo().hardware.target);
+void FirmwareHelper::fetchAllConcurrently()
+{
+    m_deviceState->setStatusString(QStringLiteral("Fetching firmware files..."));
 
-    if(!fileInfo.isValid()) {
-        fileInfo = m_versionInfo.fileInfo(type, QStringLiteral("any"));
+    // Archives needing further processing go first, so that it overlaps with the remaining downloads
+    m_pendingFetches = {
+        FileIndex::Core2Tgz,
+        FileIndex::ScriptsTgz,
+        FileIndex::Firmware,
+        FileIndex::AssetsTgz
+    };
+
+    startPendingFetches();
+}
+
+void FirmwareHelper::startPendingFetches()
+{
+    while(!m_pendingFetches.isEmpty() && (m_activeFetchCount < MAX_CONCURRENT_FETCHES) && (state() != AbstractOperationHelper::Finished)) {
+        const auto index = m_pendingFetches.takeFirst();
+
+        ++m_activeFetchCount;
+        fetchFile(index, remoteFileInfo(index));
     }
+}
 
-    fetchFile(FileIndex::AssetsTgz, fileInfo);
+const Updates::FileInfo FirmwareHelper::remoteFileInfo(FileIndex index) const
+{
+    const auto &target = m_deviceState->deviceInfo().hardware.target;
+
+    switch(index) {
+    case FileIndex::Firmware:
+        return m_versionInfo.fileInfo(QStringLiteral("full_dfu"), target);
+    case FileIndex::Core2Tgz:
+        return m_versionInfo.fileInfo(QStringLiteral("core2_firmware_tgz"), QStringLiteral("any"));
+    case FileIndex::ScriptsTgz:
+        return m_versionInfo.fileInfo(QStringLiteral("scripts_tgz"), QStringLiteral("any"));
+    case FileIndex::AssetsTgz: {
+        const auto type = QStringLiteral("resources_tgz");
+        const auto fileInfo = m_versionInfo.fileInfo(type, target);
+        return fileInfo.isValid() ? fileInfo : m_versionInfo.fileInfo(type, QStringLiteral("any"));
+    }
+    default:
+        return Updates::FileInfo();
+    }
 }
 
 void FirmwareHelper::fetchFile(FileIndex index, const Updates::FileInfo &fileInfo)
@@ -178,6 +240,16 @@ void FirmwareHelper::fetchFile(FileIndex index, const Updates::FileInfo &fileInf
         return;
     }
 
+    m_checksums.insert(index, fileInfo.sha256());
+
+    auto *storedFile = globalArtifactStore->file(fileInfo.sha256(), this);
+
+    if(storedFile) {
+        m_files.insert(index, storedFile);
+        onFileReady(index);
+        return;
+    }
+
     const auto fileName = QUrl(fileInfo.url()).fileName();
 
     auto *file = globalTempDirs->createFile(fileName, this);
@@ -189,12 +261,49 @@ void FirmwareHelper::fetchFile(FileIndex index, const Updates::FileInfo &fileInf
     }
 
     connect(fetcher, &RemoteFileFetcher::finished, this, [=]() {
-        m_files.insert(index, file);
+        fetcher->deleteLater();
+
+        if(state() == AbstractOperationHelper::Finished) {
+            file->remove();
+            return;
 
-        if(fetcher->isError()) {
+        } else if(fetcher->isError()) {
+            m_files.insert(index, file);
             finishWithError(fetcher->error(), QStringLiteral("Failed to fetch file: %1").arg(fetcher->errorString()));
-        } else {
-            advanceState();
+            return;
         }
+
+        // Fall back to the temporary file if it could not be stored
+        auto *storedFile = globalArtifactStore->insert(fileInfo.sha256(), file, this);
+        m_files.insert(index, storedFile ? storedFile : file);
+
+        onFileReady(index);
     });
 }
+
+void FirmwareHelper::onFileReady(FileIndex index)
+{
+    if(m_fetchMode == FetchMode::Sequential) {
+        advanceState();
+        return;
+    }
+
+    if(index == FileIndex::Core2Tgz) {
+        prepareRadioFirmware();
+    } else if(index == FileIndex::ScriptsTgz) {
+        prepareOptionBytes();
+    }
+
+    if(index != FileIndex::RadioFirmware && index != FileIndex::OptionBytes) {
+        --m_activeFetchCount;
+        startPendingFetches();
+    }
+
+    if(m_pendingFetches.isEmpty() && m_activeFetchCount == 0) {
+        globalResourceScheduler->release(ResourceScheduler::Resource::Network, this);
+    }
+
+    if(m_files.size() == TOTAL_FILE_COUNT) {
+        finish();
+    }
+}
@@ -23,10 +23,15 @@ class FirmwareHelper : public AbstractOperationHelper
         PreparingRadioFirmware,
         FetchingScripts,
         PreparingOptionBytes,
-        FetchingAssets
+        FetchingAssets,
+        FetchingConcurrently
     };
 
 public:
+    enum class FetchMode {
+        Sequential,
+        Concurrent
+    };
 
     enum class FileIndex {
         Firmware,
@@ -38,6 +43,7 @@ public:
     };
 
     FirmwareHelper(DeviceState *deviceState, const Updates::VersionInfo &versionInfo, QObject *parent = nullptr);
+    FirmwareHelper(DeviceState *deviceState, const Updates::VersionInfo &versionInfo, FetchMode fetchMode, QObject *parent = nullptr);
     ~FirmwareHelper();
 
     QFile *file(FileIndex index) const;
@@ -52,12 +58,20 @@ private:
     void fetchScripts();
     void prepareOptionBytes();
     void fetchAssets();
+    void fetchAllConcurrently();
+    void startPendingFetches();
 
+    const Updates::FileInfo remoteFileInfo(FileIndex index) const;
     void fetchFile(FileIndex index, const Updates::FileInfo &fileInfo);
+    void onFileReady(FileIndex index);
 
     DeviceState *m_deviceState;
     Updates::VersionInfo m_versionInfo;
+    FetchMode m_fetchMode;
     QMap<FileIndex, QFile*> m_files;
+    QMap<FileIndex, QByteArray> m_checksums;
+    QList<FileIndex> m_pendingFetches;
+    int m_activeFetchCount;
     bool m_hasRadioUpdate;
 };
 
@@ -11,8 +11,13 @@ using namespace Flipper;
 using namespace Zero;
 
 RadioManifestHelper::RadioManifestHelper(QFile *radioArchive, QObject *parent):
+    RadioManifestHelper(radioArchive, QByteArray(), parent)
+{}
+
+RadioManifestHelper::RadioManifestHelper(QFile *radioArchive, const QByteArray &checksum, QObject *parent):
     AbstractOperationHelper(parent),
-    m_compressedFile(radioArchive)
+    m_compressedFile(radioArchive),
+    m_checksum(checksum)
 {}
 
 int RadioManifestHelper::stackType() const
@@ -53,7 +58,7 @@ void RadioManifestHelper::nextStateLogic()
 
 void RadioManifestHelper::uncompressArchive()
 {
-    m_archive = new TarZipArchive(m_compressedFile, this);
+    m_archive = new TarZipArchive(m_compressedFile, m_checksum, true, this);
 
     if(m_archive->isError()) {
         finishWithError(m_archive->error(), QStringLiteral("Failed to uncompress archive file: %1").arg(m_archive->errorString()));
@@ -20,6 +20,7 @@ class RadioManifestHelper : public AbstractOperationHelper
 
 public:
     RadioManifestHelper(QFile *radioArchive, QObject *parent = nullptr);
+    RadioManifestHelper(QFile *radioArchive, const QByteArray &checksum, QObject *parent = nullptr);
 
     int stackType() const;
     const QString &radioVersion() const;
@@ -35,6 +36,7 @@ private:
     void readManifest();
 
     QFile *m_compressedFile;
+    QByteArray m_checksum;
     TarZipArchive *m_archive;
     RadioManifest m_manifest;
 };
@@ -9,8 +9,13 @@ using namespace Flipper;
 using namespace Zero;
 
 ScriptsHelper::ScriptsHelper(QFile *scriptsArchive, QObject *parent):
+    ScriptsHelper(scriptsArchive, QByteArray(), parent)
+{}
+
+ScriptsHelper::ScriptsHelper(QFile *scriptsArchive, const QByteArray &checksum, QObject *parent):
     AbstractOperationHelper(parent),
-    m_compressedFile(scriptsArchive)
+    m_compressedFile(scriptsArchive),
+    m_checksum(checksum)
 {}
 
 const QByteArray ScriptsHelper::optionBytesData() const
@@ -31,7 +36,7 @@ void ScriptsHelper::nextStateLogic()
 
 void ScriptsHelper::uncompressArchive()
 {
-    m_archive = new TarZipArchive(m_compressedFile, this);
+    m_archive = new TarZipArchive(m_compressedFile, m_checksum, true, this);
 
     if(m_archive->isError()) {
         finishWithError(m_archive->error(), QStringLiteral("Failed to uncompress archive file: %1").arg(m_archive->errorString()));
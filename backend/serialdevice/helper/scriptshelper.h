@@ -20,6 +20,7 @@ class ScriptsHelper : public AbstractOperationHelper
 
 public:
     ScriptsHelper(QFile *scriptsArchive, QObject *parent = nullptr);
+    ScriptsHelper(QFile *scriptsArchive, const QByteArray &checksum, QObject *parent = nullptr);
 
     const QByteArray optionBytesData() const;
 
@@ -28,6 +29,7 @@ private:
     void uncompressArchive();
 
     QFile *m_compressedFile;
+    QByteArray m_checksum;
     TarZipArchive *m_archive;
 };
 
@@ -34,7 +34,7 @@ void AbstractTopLevelHelper::onUpdateRegistryStateChanged()
     if(m_updateRegistry->state() == UpdateRegistry::State::ErrorOccured) {
         finishEarly(BackendError::InternetError, QStringLiteral("Failed to retrieve update information"));
     } else if(m_updateRegistry->state() == UpdateRegistry::State::Ready) {
-        disconnect(m_updateRegistry, &UpdateRegistry::stateChanged, this, &AbstractTopLevelHelper::onUpdateRegistryStateChanged);
+        disconnect(m_updateRegistry, &UpdateRegistry::checkFinished, this, &AbstractTopLevelHelper::onUpdateRegistryStateChanged);
 
         if(!m_device->deviceState()->isOnline()) {
             finishEarly(BackendError::OperationError, QStringLiteral("Connection to device was lost"));
@@ -60,7 +60,8 @@ void AbstractTopLevelHelper::checkForUpdates()
 {
     m_device->deviceState()->setStatusString(tr("Checking for updates..."));
 
-    connect(m_updateRegistry, &UpdateRegistry::stateChanged, this, &AbstractTopLevelHelper::onUpdateRegistryStateChanged);
+    // A revalidation of already loaded data does not change the registry state
+    connect(m_updateRegistry, &UpdateRegistry::checkFinished, this, &AbstractTopLevelHelper::onUpdateRegistryStateChanged);
     m_updateRegistry->check();
 }
 
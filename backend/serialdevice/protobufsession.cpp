@@ -2,7 +2,9 @@
 
 #include <QDir>
 #include <QDebug>
+#include <QHash>
 #include <QTimer>
+#include <QPointer>
 #include <QSerialPort>
 #include <QPluginLoader>
 #include <QLoggingCategory>
@@ -46,9 +48,58 @@ Q_IMPORT_PLUGIN(ProtobufPlugin)
 
 Q_LOGGING_CATEGORY(LOG_SESSION, "RPC")
 
+#define HANDOFF_TIMEOUT_MS 5000
+
 using namespace Flipper;
 using namespace Zero;
 
+/* Serial ports left open in RPC mode by handOffSession(), keyed by system location.
+ * They are closed if no session claims them in time. */
+static QHash<QString, QPointer<QSerialPort>> &handedOffPorts()
+{
+    static QHash<QString, QPointer<QSerialPort>> ports;
+    return ports;
+}
+
+static void parkSerialPort(const QString &systemLocation, QSerialPort *serialPort)
+{
+    auto &ports = handedOffPorts();
+
+    if(auto *stalePort = ports.take(systemLocation).data()) {
+        stalePort->close();
+        stalePort->deleteLater();
+    }
+
+    ports.insert(systemLocation, serialPort);
+
+    QTimer::singleShot(HANDOFF_TIMEOUT_MS, serialPort, [=]() {
+        auto &ports = handedOffPorts();
+
+        // Already claimed by another session
+        if(ports.value(systemLocation) != serialPort) {
+            return;
+        }
+
+        qCDebug(LOG_SESSION) << "Closing unclaimed serial port at" << systemLocation;
+
+        ports.remove(systemLocation);
+        serialPort->close();
+        serialPort->deleteLater();
+    });
+}
+
+static QSerialPort *takeSerialPort(const QString &systemLocation)
+{
+    auto *serialPort = handedOffPorts().take(systemLocation).data();
+
+    if(serialPort && (!serialPort->isOpen() || serialPort->error() != QSerialPort::NoError)) {
+        serialPort->deleteLater();
+        return nullptr;
+    }
+
+    return serialPort;
+}
+
 ProtobufSession::ProtobufSession(const QSerialPortInfo &portInfo, QObject *parent):
     QObject(parent),
     m_sessionState(Stopped),
@@ -214,6 +265,11 @@ GuiSendInputOperation *ProtobufSession::guiSendInput(int key, int type)
     return enqueueOperation(new GuiSendInputOperation(getAndIncrementCounter(), key, type, this));
 }
 
+GuiSendInputOperation *ProtobufSession::guiSendInput(const QVector<QPair<int, int>> &events)
+{
+    return enqueueOperation(new GuiSendInputOperation(getAndIncrementCounter(), events, this));
+}
+
 GuiScreenFrameOperation *ProtobufSession::guiSendScreenFrame(const QByteArray &screenData)
 {
     return enqueueOperation(new GuiScreenFrameOperation(getAndIncrementCounter(), screenData, this));
@@ -242,6 +298,15 @@ void ProtobufSession::startSession()
         return;
     }
 
+    // Skip the whole CLI-to-RPC handshake if the port is already in RPC mode
+    if(auto *serialPort = takeSerialPort(m_portInfo.systemLocation())) {
+        qCInfo(LOG_SESSION) << "Taking over the serial port from the previous session";
+
+        serialPort->setParent(this);
+        attachSerialPort(serialPort);
+        return;
+    }
+
     auto *helper = new SerialInitHelper(m_portInfo, this);
     connect(helper, &SerialInitHelper::finished, this, [=]() {
         helper->deleteLater();
@@ -252,20 +317,7 @@ void ProtobufSession::startSession()
             return;
         }
 
-        m_serialPort = helper->serialPort();
-
-        connect(m_serialPort, &QSerialPort::readyRead, this, &ProtobufSession::onSerialPortReadyRead);
-        connect(m_serialPort, &QSerialPort::bytesWritten, this, &ProtobufSession::onSerialPortBytesWriten);
-        connect(m_serialPort, &QSerialPort::errorOccurred, this, &ProtobufSession::onSerialPortErrorOccured);
-
-        qCInfo(LOG_SESSION) << "RPC session started successfully.";
-
-        if(!m_queue.isEmpty()) {
-            setSessionState(Running);
-            QTimer::singleShot(0, this, &ProtobufSession::processQueue);
-        } else {
-            setSessionState(Idle);
-        }
+        attachSerialPort(helper->serialPort());
     });
 }
 
@@ -279,6 +331,15 @@ void ProtobufSession::stopSession()
     QTimer::singleShot(0, this, &ProtobufSession::doStopSession);
 }
 
+void ProtobufSession::handOffSession()
+{
+    if(!isSessionUp()) {
+        return;
+    }
+
+    QTimer::singleShot(0, this, &ProtobufSession::doHandOffSession);
+}
+
 void ProtobufSession::onSerialPortReadyRead()
 {
     if(!isSessionUp()) {
@@ -411,6 +472,30 @@ void ProtobufSession::doStopSession()
     setSessionState(Stopped);
 }
 
+void ProtobufSession::doHandOffSession()
+{
+    // Only an idle session can be handed off
+    if(!m_serialPort || m_currentOperation || !m_queue.isEmpty()) {
+        doStopSession();
+        return;
+    }
+
+    qCInfo(LOG_SESSION) << "Handing off RPC session...";
+
+    m_serialPort->disconnect(this);
+    m_serialPort->setParent(nullptr);
+
+    parkSerialPort(m_portInfo.systemLocation(), m_serialPort);
+    m_serialPort = nullptr;
+
+    // Keep the plugin library loaded for the next session
+    m_plugin = nullptr;
+
+    qCInfo(LOG_SESSION) << "RPC session handed off successfully.";
+
+    setSessionState(Stopped);
+}
+
 void ProtobufSession::onCurrentOperationFinished()
 {
     if(m_currentOperation->isError()) {
@@ -438,6 +523,27 @@ void ProtobufSession::setSessionState(SessionState newState)
     emit sessionStateChanged();
 }
 
+void ProtobufSession::attachSerialPort(QSerialPort *serialPort)
+{
+    m_serialPort = serialPort;
+
+    // Nothing received before this point belongs to this session
+    m_serialPort->readAll();
+
+    connect(m_serialPort, &QSerialPort::readyRead, this, &ProtobufSession::onSerialPortReadyRead);
+    connect(m_serialPort, &QSerialPort::bytesWritten, this, &ProtobufSession::onSerialPortBytesWriten);
+    connect(m_serialPort, &QSerialPort::errorOccurred, this, &ProtobufSession::onSerialPortErrorOccured);
+
+    qCInfo(LOG_SESSION) << "RPC session started successfully.";
+
+    if(!m_queue.isEmpty()) {
+        setSessionState(Running);
+        QTimer::singleShot(0, this, &ProtobufSession::processQueue);
+    } else {
+        setSessionState(Idle);
+    }
+}
+
 #if !defined(QT_STATIC)
 const QString ProtobufSession::protobufPluginFileName(uint32_t versionMajor)
 {
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <QPair>
 #include <QQueue>
+#include <QVector>
 #include <QObject>
 #include <QSerialPortInfo>
 
@@ -92,6 +94,7 @@ public:
     GuiStartVirtualDisplayOperation *guiStartVirtualDisplay(const QByteArray &screenData = QByteArray());
     GuiStopVirtualDisplayOperation *guiStopVirtualDisplay();
     GuiSendInputOperation *guiSendInput(int key, int type);
+    GuiSendInputOperation *guiSendInput(const QVector<QPair<int, int>> &events);
     GuiScreenFrameOperation *guiSendScreenFrame(const QByteArray &screenData);
 
     PropertyGetOperation *propertyGet(const QByteArray &key);
@@ -103,6 +106,8 @@ signals:
 public slots:
     void startSession();
     void stopSession();
+    // Stops the session, but leaves the port open in RPC mode for the next session on it
+    void handOffSession();
 
 private slots:
     void onSerialPortReadyRead();
@@ -112,6 +117,7 @@ private slots:
     void processQueue();
     void writeToPort();
     void doStopSession();
+    void doHandOffSession();
 
     void onCurrentOperationFinished();
 
@@ -122,6 +128,7 @@ private:
     static QVector<uint32_t> supportedProtobufVersions();
 
     void setSessionState(SessionState newState);
+    void attachSerialPort(QSerialPort *serialPort);
 
     bool loadProtobufPlugin();
     void unloadProtobufPlugin();
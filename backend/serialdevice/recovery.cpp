@@ -1,5 +1,11 @@
 #include "recovery.h"
 
+#include <cstring>
+
+#include <QBuffer>
+#include <QFileDevice>
+#include <QElapsedTimer>
+
 #include "devicestate.h"
 #include "dfusefile.h"
 #include "debug.h"
@@ -18,30 +24,174 @@ using namespace WB55;
  * ---------------------------------------------------------------------------------------------------------------------------------- */
 
 #define to_hex_str(num) (QString::number(num, 16))
+#define FLASH_PAGE_SIZE ((uint32_t)0x1000) // TODO: do not hardcode page size
+
+namespace {
+// Logs the wall time of a recovery step when going out of scope
+class StepTimer
+{
+public:
+    StepTimer(const char *stepName):
+        m_stepName(stepName)
+    {
+        m_timer.start();
+    }
+
+    ~StepTimer()
+    {
+        debug_msg(QStringLiteral("Recovery step %1 took %2 ms").arg(QLatin1String(m_stepName)).arg(m_timer.elapsed()));
+    }
+
+private:
+    const char *m_stepName;
+    QElapsedTimer m_timer;
+};
+
+// Read-only view of the rest of an open image file. Memory-mapped when the file
+// supports it, so that the contents are neither read up front nor copied.
+// Closing the file unmaps it, so the view must not be used past that.
+class MappedImage
+{
+    Q_DISABLE_COPY(MappedImage)
+
+public:
+    MappedImage(QIODevice *file):
+        m_file(qobject_cast<QFileDevice*>(file)),
+        m_map(nullptr)
+    {
+        const auto size = file->bytesAvailable();
+
+        if(m_file && size > 0) {
+            m_map = m_file->map(m_file->pos(), size);
+        }
+
+        if(m_map) {
+            m_data = QByteArray::fromRawData((const char*)m_map, (int)size);
+        } else {
+            m_data = file->readAll();
+        }
+    }
+
+    ~MappedImage()
+    {
+        if(m_map && m_file->isOpen()) {
+            m_file->unmap(m_map);
+        }
+    }
+
+    const QByteArray &data() const
+    {
+        return m_data;
+    }
+
+private:
+    QFileDevice *m_file;
+    uchar *m_map;
+    QByteArray m_data;
+};
+
+int pageSpan(uint32_t addr, int size)
+{
+    const auto begin = addr & ~(FLASH_PAGE_SIZE - 1);
+    const auto end = (addr + (uint32_t)size + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+    return (int)((end - begin) / FLASH_PAGE_SIZE);
+}
+
+// End of the flash available to the application, 0 if unknown.
+// The secure area starting at SFSA belongs to the co-processor and cannot be read back.
+uint32_t userFlashEnd(STM32WB55 *device)
+{
+    const auto ob = device->optionBytes();
+
+    if(!ob.isValid()) {
+        return 0;
+    }
+
+    return device->partitionOrigin((uint8_t)STM32WB55::Partition::Flash) + FLASH_PAGE_SIZE * ob.value("SFSA");
+}
+
+// Only the main flash can be read back, compared and erased page by page
+bool isUserFlashRange(STM32WB55 *device, uint32_t flashEnd, uint32_t addr, int size, uint8_t alt)
+{
+    const auto flashBegin = device->partitionOrigin((uint8_t)STM32WB55::Partition::Flash);
+    return (alt == 0) && (addr >= flashBegin) && ((qint64)addr + size <= (qint64)flashEnd);
+}
+
+// Number of flash pages covered by the image, -1 if it has anything else than main flash data
+int differentialPageCount(STM32WB55 *device, const DfuseFile &fw)
+{
+    const auto flashEnd = userFlashEnd(device);
+    auto pageCount = 0;
+
+    for(const auto &image : fw.images()) {
+        for(const auto &element : image.elements()) {
+            if(!isUserFlashRange(device, flashEnd, element.address(), element.data().size(), image.alternateSetting())) {
+                return -1;
+            }
+
+            pageCount += pageSpan(element.address(), element.data().size());
+        }
+    }
+
+    return pageCount;
+}
+}
 
 Recovery::Recovery(DeviceState *deviceState, QObject *parent):
     QObject(parent),
-    m_deviceState(deviceState)
-{}
+    m_deviceState(deviceState),
+    m_isSessionStale(0),
+    m_sessionOpenCount(0),
+    m_sessionReuseCount(0),
+    m_isDifferentialFlashing(true)
+{
+    // The device has re-enumerated or is gone, the old handle is of no use anymore
+    connect(m_deviceState, &DeviceState::deviceInfoChanged, this, &Recovery::onDeviceStateChanged);
+    connect(m_deviceState, &DeviceState::isOnlineChanged, this, &Recovery::onDeviceStateChanged);
+}
 
 Recovery::~Recovery()
-{}
+{
+    QMutexLocker locker(&m_sessionMutex);
+    closeSession();
+}
 
 DeviceState *Recovery::deviceState() const
 {
     return m_deviceState;
 }
 
+bool Recovery::isDifferentialFlashing() const
+{
+    return m_isDifferentialFlashing;
+}
+
+void Recovery::setDifferentialFlashing(bool set)
+{
+    m_isDifferentialFlashing = set;
+}
+
+void Recovery::endSession()
+{
+    QMutexLocker locker(&m_sessionMutex);
+
+    if(m_session) {
+        debug_msg("Recovery operation finished, closing the DFU session...");
+        closeSession();
+    }
+}
+
 bool Recovery::exitRecoveryMode()
 {
+    QMutexLocker locker(&m_sessionMutex);
+
+    StepTimer timer("exitRecoveryMode");
     m_deviceState->setStatusString(QStringLiteral("Exiting recovery mode..."));
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
-    const auto success = device.beginTransaction() && device.leave();
+    auto *device = openSession();
+    const auto success = device && device->leave();
 
-    begin_ignore_block();
-    device.endTransaction();
-    end_ignore_block();
+    closeSession();
 
     if(!success) {
         setErrorString("Failed to exit recovery mode");
@@ -52,44 +202,49 @@ bool Recovery::exitRecoveryMode()
 
 bool Recovery::setBootMode(BootMode mode)
 {
+    QMutexLocker locker(&m_sessionMutex);
+
     const auto msg = (mode == BootMode::Normal) ?
                QStringLiteral("Setting OS boot mode...") :
                QStringLiteral("Setting Recovery boot mode...");
 
+    StepTimer timer("setBootMode");
     m_deviceState->setStatusString(msg);
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    auto *device = openSession();
 
-    if(!device.beginTransaction()) {
+    if(!device) {
         setErrorString("Can't set boot mode: Failed to initiate transaction.");
         return false;
     }
 
-    auto ob = device.optionBytes();
+    auto ob = device->optionBytes();
 
     if(!ob.isValid()) {
         setErrorString("Can't set boot mode: Failed to read option bytes.");
+        closeSession();
         return false;
     }
 
     ob.setValue("nBOOT0", mode == BootMode::Normal);
     ob.setValue("nSWBOOT0", mode == BootMode::Normal);
 
-    const auto success = device.setOptionBytes(ob);
+    const auto success = device->setOptionBytes(ob);
 
     if(!success) {
         setErrorString("Can't set boot mode: Failed to set option bytes");
     }
 
-    begin_ignore_block();
-    device.endTransaction();
-    end_ignore_block();
+    // Loading the option bytes resets the device
+    closeSession();
 
     return success;
 }
 
 Recovery::WirelessStatus Recovery::wirelessStatus()
 {
+    QMutexLocker locker(&m_sessionMutex);
+
     debug_msg("Getting Co-Processor (Wireless) status...");
 
     if(!m_deviceState->isOnline()) {
@@ -97,21 +252,19 @@ Recovery::WirelessStatus Recovery::wirelessStatus()
         return WirelessStatus::Invalid;
     }
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    StepTimer timer("wirelessStatus");
+    auto *device = openSession();
 
-    if(!device.beginTransaction()) {
+    if(!device) {
         debug_msg("Failed to get FUS status. This is normal if the device has just rebooted.");
         return WirelessStatus::Invalid;
     }
 
-    const auto state = device.FUSGetState();
+    // The session stays open, this is typically polled repeatedly
+    const auto state = device->FUSGetState();
     if(!state.isValid()) {
         debug_msg("Failed to get FUS status. This is normal if the device has just rebooted.");
-        return WirelessStatus::Invalid;
-    }
-
-    if(!device.endTransaction()) {
-        debug_msg("Failed to get FUS status. This is normal if the device has just rebooted.");
+        closeSession();
         return WirelessStatus::Invalid;
     }
 
@@ -135,16 +288,19 @@ Recovery::WirelessStatus Recovery::wirelessStatus()
 
 bool Recovery::startFUS()
 {
+    QMutexLocker locker(&m_sessionMutex);
+
+    StepTimer timer("startFUS");
     m_deviceState->setStatusString("Starting firmware upgrade service (FUS)...");
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    auto *device = openSession();
 
-    if(!device.beginTransaction()) {
+    if(!device) {
         setErrorString("Can't start FUS: Failed to initiate transaction.");
         return false;
     }
 
-    auto state = device.FUSGetState();
+    auto state = device->FUSGetState();
     auto success = state.isValid();
 
     if(!success) {
@@ -152,14 +308,14 @@ bool Recovery::startFUS()
 
     } else if((state.status() == FUSState::Idle) && (state.error() == FUSState::NoError)) {
         debug_msg("FUS is already RUNNING, rebooting for consistency...");
-        success = device.leave();
+        success = device->leave();
 
     } else if((state.status() == FUSState::ErrorOccured) && (state.error() == FUSState::NotRunning)) {
         debug_msg(QString("FUS appears NOT to be running: %1, %2.").arg(state.statusString(), state.errorString()));
 
         // Send a second GET_STATE to actually start FUS
         begin_ignore_block();
-        state = device.FUSGetState();
+        state = device->FUSGetState();
         end_ignore_block();
 
     } else {
@@ -167,9 +323,7 @@ bool Recovery::startFUS()
         success = false;
     }
 
-    begin_ignore_block();
-    device.endTransaction();
-    end_ignore_block();
+    closeSession();
 
     // At this point, there is no way to know whether FUS has actually started, but things are looking as expected.
     return success;
@@ -178,12 +332,15 @@ bool Recovery::startFUS()
 // TODO: check status to see if the wireless stack is present at all
 bool Recovery::startWirelessStack()
 {
+    QMutexLocker locker(&m_sessionMutex);
+
+    StepTimer timer("startWirelessStack");
     m_deviceState->setStatusString("Attempting to start the Wireless Stack...");
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    auto *device = openSession();
 
-    auto success = device.beginTransaction() && device.FUSStartWirelessStack();
-    check_continue(device.endTransaction(), "^^^ It's probably nothing at this point... ^^^");
+    auto success = device && device->FUSStartWirelessStack();
+    check_continue(closeSession(), "^^^ It's probably nothing at this point... ^^^");
 
     if(!success) {
         setErrorString("Failed to start wireless stack.");
@@ -194,11 +351,15 @@ bool Recovery::startWirelessStack()
 
 bool Recovery::deleteWirelessStack()
 {
+    QMutexLocker locker(&m_sessionMutex);
+
+    StepTimer timer("deleteWirelessStack");
     m_deviceState->setStatusString("Deleting old co-processor firmware...");
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    auto *device = openSession();
 
-    const auto success = device.beginTransaction() && device.FUSFwDelete() && device.endTransaction();
+    auto success = device && device->FUSFwDelete();
+    success = closeSession() && success;
 
     if(!success) {
         setErrorString("Can't delete old co-processor firmware: Failed to initiate wireless stack firmware removal.");
@@ -209,6 +370,8 @@ bool Recovery::deleteWirelessStack()
 
 bool Recovery::downloadFirmware(QIODevice *file)
 {
+    QMutexLocker locker(&m_sessionMutex);
+
     if(!file->open(QIODevice::ReadOnly)) {
         setErrorString("Can't flash firmware: Failed to open the file.");
         return false;
@@ -221,16 +384,67 @@ bool Recovery::downloadFirmware(QIODevice *file)
         m_deviceState->setStatusString("Flashing firmware...");
     }
 
-    DfuseFile fw(file);
-    DfuseDevice dev(m_deviceState->deviceInfo().usbInfo);
+    StepTimer timer("downloadFirmware");
 
-    file->close();
+    const MappedImage image(file);
 
-    connect(&dev, &DfuseDevice::progressChanged, this, [=](int operation, double progress) {
-        m_deviceState->setProgress(progress / 2.0 + (operation == DfuseDevice::Download ? 50 : 0));
-    });
+    QBuffer buffer;
+    buffer.setData(image.data());
+    buffer.open(QIODevice::ReadOnly);
+
+    DfuseFile fw(&buffer);
+
+    auto *device = openSession();
+    auto success = false;
+    auto isFullDownload = !m_isDifferentialFlashing;
+
+    if(device && m_isDifferentialFlashing) {
+        const auto plannedPages = differentialPageCount(device, fw);
+
+        if(plannedPages < 0) {
+            debug_msg("Firmware image has data outside of the main flash, using full download");
+            isFullDownload = true;
+
+        } else {
+            FlashStats stats = {plannedPages, 0, 0, false};
+            success = true;
+
+            for(const auto &dfuImage : fw.images()) {
+                for(const auto &element : dfuImage.elements()) {
+                    success = downloadDifferential(device, element.data(), element.address(), dfuImage.alternateSetting(), stats);
+
+                    if(!success) {
+                        break;
+                    }
+                }
+
+                if(!success) {
+                    break;
+                }
+            }
+
+            if(stats.isReadBackFailed) {
+                debug_msg("Failed to read back the flash contents, falling back to full download");
+                isFullDownload = true;
+
+            } else if(success) {
+                debug_msg(QStringLiteral("Differential firmware download: %1 of %2 pages skipped")
+                          .arg(stats.skippedPages).arg(stats.totalPages));
+            }
+        }
+    }
+
+    if(device && isFullDownload) {
+        const auto connection = connect(device, &DfuseDevice::progressChanged, this, [=](int operation, double progress) {
+            m_deviceState->setProgress(progress / 2.0 + (operation == DfuseDevice::Download ? 50 : 0));
+        });
 
-    const auto success = dev.beginTransaction() && dev.download(&fw) && dev.endTransaction();
+        success = device->download(&fw);
+        disconnect(connection);
+    }
+
+    success = closeSession() && success;
+    file->close();
 
     if(!success) {
         setErrorString("Can't flash firmware: An error has occurred during the operation.");
@@ -241,6 +455,8 @@ bool Recovery::downloadFirmware(QIODevice *file)
 
 bool Recovery::downloadWirelessStack(QIODevice *file, uint32_t addr)
 {
+    QMutexLocker locker(&m_sessionMutex);
+
     debug_msg("Attempting to flash CO-PROCESSOR firmware image...");
 
     if(!file->open(QIODevice::ReadOnly)) {
@@ -255,25 +471,31 @@ bool Recovery::downloadWirelessStack(QIODevice *file, uint32_t addr)
         m_deviceState->setStatusString("Flashing co-processor firmware image...");
     }
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    StepTimer timer("downloadWirelessStack");
+
+    const MappedImage image(file);
+    const auto &data = image.data();
+
+    auto *device = openSession();
 
-    if(!device.beginTransaction()) {
+    if(!device) {
         setErrorString("Can't flash co-processor firmware image: Failed to initiate transaction.");
+        file->close();
         return false;
     }
 
     if(!addr) {
-        const auto ob = device.optionBytes();
+        const auto ob = device->optionBytes();
 
         if(!ob.isValid()) {
             setErrorString("Can't flash co-processor firmware image: Failed to read Option Bytes.");
+            closeSession();
+            file->close();
             return false;
         }
 
-        const auto origin = device.partitionOrigin((uint8_t)STM32WB55::Partition::Flash);
-        const auto pageSize = (uint32_t)0x1000; // TODO: do not hardcode page size
-
-        addr = (origin + (pageSize * ob.value("SFSA")) - file->bytesAvailable()) & (~(pageSize - 1));
+        const auto origin = device->partitionOrigin((uint8_t)STM32WB55::Partition::Flash);
+        addr = (origin + (FLASH_PAGE_SIZE * ob.value("SFSA")) - data.size()) & (~(FLASH_PAGE_SIZE - 1));
 
         debug_msg(QString("SFSA value is 0x%1").arg(QString::number(ob.value("SFSA"), 16)));
         debug_msg(QString("Target address for co-processor firmware image is 0x%1").arg(QString::number(addr, 16)));
@@ -282,33 +504,68 @@ bool Recovery::downloadWirelessStack(QIODevice *file, uint32_t addr)
         debug_msg(QString("Target address for co-processor firmware image has been OVERRIDDEN to 0x%1").arg(QString::number(addr, 16)));
     }
 
-    connect(&device, &DfuseDevice::progressChanged, this, [=](int operation, double progress) {
+    bool success = false;
+
+    const auto isDifferential = m_isDifferentialFlashing &&
+                                isUserFlashRange(device, userFlashEnd(device), addr, data.size(), 0);
+
+    if(isDifferential) {
+        FlashStats stats = {pageSpan(addr, data.size()), 0, 0, false};
+        success = downloadDifferential(device, data, addr, 0, stats);
+
+        if(stats.isReadBackFailed) {
+            debug_msg("Failed to read back the flash contents, falling back to full download");
+
+        } else if(!success) {
+            setErrorString("Can't flash co-processor firmware image: Failed to write the internal memory.");
+            closeSession();
+            file->close();
+            return false;
+
+        } else {
+            debug_msg(QStringLiteral("Differential co-processor firmware download: %1 of %2 pages skipped")
+                      .arg(stats.skippedPages).arg(stats.totalPages));
+            file->close();
+            return true;
+        }
+    }
+
+    const auto connection = connect(device, &DfuseDevice::progressChanged, this, [=](int operation, double progress) {
         m_deviceState->setProgress(progress / 2.0 + (operation == DfuseDevice::Download ? 50 : 0));
     });
 
-    bool success;
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
 
-    if(!(success = device.erase(addr, file->bytesAvailable()))) {
+    if(!(success = device->erase(addr, data.size()))) {
         setErrorString("Can't flash co-processor firmware image: Failed to erase the internal memory.");
-    } else if(!(success = device.download(file, addr, 0))) {
+    } else if(!(success = device->download(&buffer, addr, 0))) {
         setErrorString("Can't flash co-processor firmware image: Failed to write the internal memory.");
-    } else if(!(success = device.endTransaction())) {
-        setErrorString("Can't flash co-processor firmware image: Failed to end transaction.");
     } else {}
 
+    disconnect(connection);
     file->close();
 
+    // On success, the session is reused by the upgrade command that follows
+    if(!success) {
+        closeSession();
+    }
+
     return success;
 }
 
 bool Recovery::upgradeWirelessStack()
 {
+    QMutexLocker locker(&m_sessionMutex);
+
+    StepTimer timer("upgradeWirelessStack");
     debug_msg("Sending FW_UPGRADE command...");
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    auto *device = openSession();
 
-    const auto success = device.beginTransaction() && device.FUSFwUpgrade();
-    check_continue(device.endTransaction(), "^^^ It's probably nothing at this point... ^^^");
+    const auto success = device && device->FUSFwUpgrade();
+    check_continue(closeSession(), "^^^ It's probably nothing at this point... ^^^");
 
     if(!success) {
         setErrorString("Can't upgrade Co-Processor firmware: Failed to initiate installation.");
@@ -321,20 +578,18 @@ bool Recovery::upgradeWirelessStack()
 
 bool Recovery::checkWirelessStack()
 {
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
-
-    if(!device.beginTransaction()) {
-        setErrorString(QStringLiteral("Failed to read co-processor firmware version info"));
-        return false;
-    }
+    QMutexLocker locker(&m_sessionMutex);
 
-    const auto versionInfo = device.versionInfo();
+    StepTimer timer("checkWirelessStack");
+    auto *device = openSession();
 
-    if(!device.endTransaction()) {
+    if(!device) {
         setErrorString(QStringLiteral("Failed to read co-processor firmware version info"));
         return false;
     }
 
+    const auto versionInfo = device->versionInfo();
+
     qCDebug(CATEGORY_DEBUG).noquote() << "FUS version:" << versionInfo.FUSVersion;
     qCDebug(CATEGORY_DEBUG).noquote() << "Wireless Stack version:" << versionInfo.WirelessVersion;
 
@@ -343,6 +598,8 @@ bool Recovery::checkWirelessStack()
 
 bool Recovery::downloadOptionBytes(QIODevice *file)
 {
+    QMutexLocker locker(&m_sessionMutex);
+
     m_deviceState->setStatusString("Downloading Option Bytes...");
 
     check_return_bool(file->open(QIODevice::ReadOnly), "Failed to open file for reading");
@@ -351,10 +608,11 @@ bool Recovery::downloadOptionBytes(QIODevice *file)
 
     check_return_bool(loaded.isValid(), "Failed to load option bytes from file");
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    StepTimer timer("downloadOptionBytes");
+    auto *device = openSession();
 
-    check_return_bool(device.beginTransaction(), "Failed to initiate transaction");
-    const OptionBytes actual = device.optionBytes();
+    check_return_bool(device, "Failed to initiate transaction");
+    const OptionBytes actual = device->optionBytes();
 
     const auto diff = actual.compare(loaded);
 
@@ -363,7 +621,7 @@ bool Recovery::downloadOptionBytes(QIODevice *file)
     if(diff.isEmpty()) {
         debug_msg("Option Bytes OK");
 
-        success = device.leave();
+        success = device->leave();
 
         if(!success) {
             setErrorString("Can't set boot mode: Failed to leave the Recovery mode.");
@@ -377,16 +635,15 @@ bool Recovery::downloadOptionBytes(QIODevice *file)
 
         debug_msg("Writing corrected Option Bytes...");
 
-        success = device.setOptionBytes(actual.corrected(diff));
+        success = device->setOptionBytes(actual.corrected(diff));
 
         if(!success) {
             setErrorString("Can't set boot mode: Failed to set option bytes");
         }
     }
 
-    begin_ignore_block();
-    device.endTransaction();
-    end_ignore_block();
+    // Either way the device is going to reset
+    closeSession();
 
     if(success) {
         m_deviceState->setStatusString(QStringLiteral("Exiting recovery mode..."));
@@ -394,3 +651,132 @@ bool Recovery::downloadOptionBytes(QIODevice *file)
 
     return success;
 }
+
+/* Reads back the flash pages covered by the data and only erases and writes
+ * the runs of pages that differ. Bytes outside of the data in the partially
+ * covered pages are preserved from the read back contents. */
+bool Recovery::downloadDifferential(STM32WB55 *device, const QByteArray &data, uint32_t addr, uint8_t alt, FlashStats &stats)
+{
+    const auto begin = addr & ~(FLASH_PAGE_SIZE - 1);
+    const auto end = (addr + (uint32_t)data.size() + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+    const auto pageCount = pageSpan(addr, data.size());
+
+    // Progress is accumulated over all the elements of the image
+    const auto basePage = stats.totalPages;
+    const auto plannedPages = qMax(stats.plannedPages, basePage + pageCount);
+
+    QBuffer current;
+    current.open(QIODevice::WriteOnly);
+
+    if(!device->upload(&current, begin, end - begin, alt) || (current.size() != (qint64)(end - begin))) {
+        stats.isReadBackFailed = true;
+        return false;
+    }
+
+    const auto &actual = current.buffer();
+
+    auto wanted = actual;
+    wanted.replace(addr - begin, data.size(), data);
+
+    const auto isPageEqual = [&](int page) {
+        const auto offset = page * FLASH_PAGE_SIZE;
+        return !memcmp(actual.constData() + offset, wanted.constData() + offset, FLASH_PAGE_SIZE);
+    };
+
+    stats.totalPages += pageCount;
+
+    for(auto page = 0; page < pageCount;) {
+        if(isPageEqual(page)) {
+            ++stats.skippedPages;
+            ++page;
+            continue;
+        }
+
+        // Coalesce adjacent differing pages into a single erase and write
+        auto runEnd = page + 1;
+
+        while(runEnd < pageCount && !isPageEqual(runEnd)) {
+            ++runEnd;
+        }
+
+        const auto runAddr = begin + page * FLASH_PAGE_SIZE;
+        const auto runData = wanted.mid(page * FLASH_PAGE_SIZE, (runEnd - page) * FLASH_PAGE_SIZE);
+
+        if(!device->erase(runAddr, runData.size())) {
+            return false;
+        }
+
+        // Freshly erased flash already reads as 0xff
+        if(runData.count('\xff') != runData.size()) {
+            QBuffer chunk;
+            chunk.setData(runData);
+            chunk.open(QIODevice::ReadOnly);
+
+            if(!device->download(&chunk, runAddr, alt)) {
+                return false;
+            }
+        }
+
+        page = runEnd;
+        m_deviceState->setProgress((basePage + page) * 100.0 / plannedPages);
+    }
+
+    m_deviceState->setProgress((basePage + pageCount) * 100.0 / plannedPages);
+    return true;
+}
+
+void Recovery::onDeviceStateChanged()
+{
+    m_isSessionStale.storeRelease(1);
+}
+
+STM32WB55 *Recovery::openSession()
+{
+    const auto &usbInfo = m_deviceState->deviceInfo().usbInfo;
+
+    if(m_session && m_isSessionStale.loadAcquire()) {
+        debug_msg("Device has re-enumerated, re-opening the DFU session...");
+        closeSession();
+    }
+
+    if(m_session) {
+        ++m_sessionReuseCount;
+        return m_session.data();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    m_isSessionStale.storeRelease(0);
+    m_session.reset(new STM32WB55(usbInfo));
+    // Not bound to the opening thread, the next step may run in another one
+    m_session->moveToThread(nullptr);
+
+    if(!m_session->beginTransaction()) {
+        m_session.reset();
+        return nullptr;
+    }
+
+    ++m_sessionOpenCount;
+
+    debug_msg(QStringLiteral("Opened DFU session in %1 ms (opened: %2, reused: %3)")
+              .arg(timer.elapsed()).arg(m_sessionOpenCount).arg(m_sessionReuseCount));
+
+    return m_session.data();
+}
+
+bool Recovery::closeSession()
+{
+    if(!m_session) {
+        return false;
+    }
+
+    bool success;
+
+    begin_ignore_block();
+    success = m_session->endTransaction();
+    end_ignore_block();
+
+    m_session.reset();
+    return success;
+}
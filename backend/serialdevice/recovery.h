@@ -1,12 +1,19 @@
 #pragma once
 
+#include <QMutex>
 #include <QObject>
+#include <QAtomicInt>
+#include <QScopedPointer>
 
 #include "failable.h"
 #include "usbdeviceinfo.h"
 
 class QIODevice;
 
+namespace STM32 {
+class STM32WB55;
+}
+
 namespace Flipper {
 namespace Zero {
 
@@ -50,8 +57,45 @@ public:
     bool downloadOptionBytes(QIODevice *file);
     bool downloadWirelessStack(QIODevice *file, uint32_t addr = 0);
 
+    // Only erase and write the flash pages that differ from the image (default: on)
+    bool isDifferentialFlashing() const;
+    void setDifferentialFlashing(bool set);
+
+    // Releases the USB interface, blocks while a step is running.
+    // Recovery operations go through RecoveryScheduler::endSession() instead.
+    void endSession();
+
+private slots:
+    void onDeviceStateChanged();
+
 private:
+    struct FlashStats {
+        // Pages covered by all the elements to be downloaded, for the progress
+        int plannedPages;
+        int totalPages;
+        int skippedPages;
+        bool isReadBackFailed;
+    };
+
+    bool downloadDifferential(STM32::STM32WB55 *device, const QByteArray &data, uint32_t addr, uint8_t alt, FlashStats &stats);
+
+    /* The DFU transaction is kept open between the steps that do not reset
+     * the device, and is only re-opened after the device re-enumerates. */
+    STM32::STM32WB55 *openSession();
+    bool closeSession();
+
     DeviceState *m_deviceState;
+
+    /* Steps run either in the GUI thread (status polling) or in RecoveryScheduler
+     * threads (downloads). The mutex serialises them, and the session object
+     * has no thread affinity so that any of these threads may use or delete it. */
+    QMutex m_sessionMutex;
+    QScopedPointer<STM32::STM32WB55> m_session;
+    QAtomicInt m_isSessionStale;
+    int m_sessionOpenCount;
+    int m_sessionReuseCount;
+
+    bool m_isDifferentialFlashing;
 };
 
 }
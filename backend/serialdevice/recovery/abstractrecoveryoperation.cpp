@@ -4,6 +4,7 @@
 
 #include "serialdevice/recovery.h"
 #include "serialdevice/devicestate.h"
+#include "serialdevice/recoveryscheduler.h"
 
 using namespace Flipper;
 using namespace Zero;
@@ -26,6 +27,9 @@ void AbstractRecoveryOperation::start()
 void AbstractRecoveryOperation::finish()
 {
     disconnect(m_recovery->deviceState(), &DeviceState::isOnlineChanged, this, &AbstractRecoveryOperation::onDeviceOnlineChanged);
+    // Do not keep the USB interface claimed past the operation, successful or not.
+    // A download job might still be running after a timeout, do not wait for it here.
+    globalRecoveryScheduler->endSession(m_recovery);
     AbstractOperation::finish();
 }
 
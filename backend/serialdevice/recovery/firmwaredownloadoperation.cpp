@@ -1,10 +1,10 @@
 #include "firmwaredownloadoperation.h"
 
 #include <QFutureWatcher>
-#include <QtConcurrent/QtConcurrentRun>
 
 #include "serialdevice/devicestate.h"
 #include "serialdevice/recovery.h"
+#include "serialdevice/recoveryscheduler.h"
 
 using namespace Flipper;
 using namespace Zero;
@@ -36,7 +36,9 @@ void FirmwareDownloadOperation::downloadFirmware()
     auto *watcher = new QFutureWatcher<bool>(this);
 
     connect(watcher, &QFutureWatcherBase::finished, this, [=]() {
-        if(watcher->result()) {
+        if(watcher->isCanceled()) {
+            finishWithError(BackendError::RecoveryError, QStringLiteral("Another operation is already running on this device"));
+        } else if(watcher->result()) {
             advanceOperationState();
         } else {
             finishWithError(BackendError::RecoveryError, recovery()->errorString());
@@ -45,9 +47,7 @@ void FirmwareDownloadOperation::downloadFirmware()
         watcher->deleteLater();
     });
 
-#if QT_VERSION < 0x060000
-    watcher->setFuture(QtConcurrent::run(recovery(), &Recovery::downloadFirmware, m_file));
-#else
-    watcher->setFuture(QtConcurrent::run(&Recovery::downloadFirmware, recovery(), m_file));
-#endif
+    watcher->setFuture(globalRecoveryScheduler->run(recovery(), [=]() {
+        return recovery()->downloadFirmware(m_file);
+    }));
 }
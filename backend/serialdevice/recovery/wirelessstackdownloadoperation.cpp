@@ -5,10 +5,10 @@
 #include <QIODevice>
 #include <QFutureWatcher>
 #include <QLoggingCategory>
-#include <QtConcurrent/QtConcurrentRun>
 
 #include "serialdevice/devicestate.h"
 #include "serialdevice/recovery.h"
+#include "serialdevice/recoveryscheduler.h"
 
 Q_DECLARE_LOGGING_CATEGORY(LOG_RECOVERY)
 
@@ -16,17 +16,24 @@ using namespace Flipper;
 using namespace Zero;
 
 static constexpr int INSTALL_TRY_COUNT = 3;
-static constexpr int CHECK_TRY_COUNT = 3;
-static constexpr int TIMER_INTERVAL_MS = 1000;
+
+static constexpr int POLL_INTERVAL_MIN_MS = 50;
+static constexpr int POLL_INTERVAL_MAX_MS = 1000;
+// The co-processor may take well over a minute to install a stack
+static constexpr qint64 POLL_DEADLINE_MS = 180000;
+static constexpr qint64 CHECK_DEADLINE_MS = 5000;
 
 WirelessStackDownloadOperation::WirelessStackDownloadOperation(Recovery *recovery, QIODevice *file, uint32_t targetAddress, QObject *parent):
     AbstractRecoveryOperation(recovery, parent),
     m_file(file),
     m_loopTimer(new QTimer(this)),
     m_targetAddress(targetAddress),
-    m_installTryCount(INSTALL_TRY_COUNT)
+    m_installTryCount(INSTALL_TRY_COUNT),
+    m_pollInterval(POLL_INTERVAL_MIN_MS),
+    m_pollCount(0),
+    m_pollDeadline(0)
 {
-    m_loopTimer->setInterval(TIMER_INTERVAL_MS);
+    m_loopTimer->setSingleShot(true);
 
     connect(m_loopTimer, &QTimer::timeout, this, &WirelessStackDownloadOperation::nextStateLogic);
     connect(this, &AbstractOperation::finished, m_loopTimer, &QTimer::stop);
@@ -65,6 +72,7 @@ void WirelessStackDownloadOperation::nextStateLogic()
 
     } else if(operationState() == CheckingWirelessStack) {
         if(isWirelessStackOK()) {
+            stopPolling();
             finish();
         } else {
             tryAgain();
@@ -108,7 +116,7 @@ void WirelessStackDownloadOperation::deleteWirelessStack()
     if(!recovery()->deleteWirelessStack()) {
         finishWithError(BackendError::RecoveryError, recovery()->errorString());
     } else {
-        m_loopTimer->start();
+        startPolling(POLL_DEADLINE_MS);
     }
 }
 
@@ -119,10 +127,14 @@ bool WirelessStackDownloadOperation::isWirelessStackDeleted()
     const auto waitNext = (status == Recovery::WirelessStatus::Invalid) ||
                           (status == Recovery::WirelessStatus::UnhandledState);
     if(waitNext) {
+        if(!schedulePoll()) {
+            finishWithError(BackendError::RecoveryError, QStringLiteral("Failed to finish removal of the Wireless Stack: Operation timeout."));
+        }
+
         return false;
     }
 
-    m_loopTimer->stop();
+    stopPolling();
 
     const auto errorOccured = (status == Recovery::WirelessStatus::WSRunning) ||
                               (status == Recovery::WirelessStatus::ErrorOccured);
@@ -138,7 +150,9 @@ void WirelessStackDownloadOperation::downloadWirelessStack()
     auto *watcher = new QFutureWatcher<bool>(this);
 
     connect(watcher, &QFutureWatcherBase::finished, this, [=]() {
-        if(watcher->result()) {
+        if(watcher->isCanceled()) {
+            finishWithError(BackendError::RecoveryError, QStringLiteral("Another operation is already running on this device"));
+        } else if(watcher->result()) {
             advanceOperationState();
         } else {
             finishWithError(BackendError::RecoveryError, QStringLiteral("Failed to download the Wireless Stack."));
@@ -146,11 +160,9 @@ void WirelessStackDownloadOperation::downloadWirelessStack()
 
         watcher->deleteLater();
     });
-#if QT_VERSION < 0x060000
-    watcher->setFuture(QtConcurrent::run(recovery(), &Recovery::downloadWirelessStack, m_file, m_targetAddress));
-#else
-    watcher->setFuture(QtConcurrent::run(&Recovery::downloadWirelessStack, recovery(), m_file, m_targetAddress));
-#endif
+    watcher->setFuture(globalRecoveryScheduler->run(recovery(), [=]() {
+        return recovery()->downloadWirelessStack(m_file, m_targetAddress);
+    }));
 }
 
 void WirelessStackDownloadOperation::upgradeWirelessStack()
@@ -158,7 +170,7 @@ void WirelessStackDownloadOperation::upgradeWirelessStack()
     if(!recovery()->upgradeWirelessStack()) {
         finishWithError(BackendError::RecoveryError, recovery()->errorString());
     } else {
-        m_loopTimer->start();
+        startPolling(POLL_DEADLINE_MS);
     }
 }
 
@@ -169,10 +181,14 @@ bool WirelessStackDownloadOperation::isWirelessStackUpgraded()
     const auto waitNext = (status == Recovery::WirelessStatus::Invalid) ||
                           (status == Recovery::WirelessStatus::UnhandledState);
     if(waitNext) {
+        if(!schedulePoll()) {
+            finishWithError(BackendError::RecoveryError, QStringLiteral("Failed to finish installation of the Wireless Stack: Operation timeout."));
+        }
+
         return false;
     }
 
-    m_loopTimer->stop();
+    stopPolling();
 
     const auto errorOccured = (status == Recovery::WirelessStatus::ErrorOccured);
     if(errorOccured) {
@@ -184,9 +200,7 @@ bool WirelessStackDownloadOperation::isWirelessStackUpgraded()
 
 void WirelessStackDownloadOperation::checkWirelessStack()
 {
-    m_checkTryCount = CHECK_TRY_COUNT;
-    m_loopTimer->start();
-
+    startPolling(CHECK_DEADLINE_MS);
     advanceOperationState();
 }
 
@@ -197,14 +211,12 @@ bool WirelessStackDownloadOperation::isWirelessStackOK()
 
 void WirelessStackDownloadOperation::tryAgain()
 {
-    if(--m_checkTryCount > 0) {
+    if(schedulePoll()) {
         qCDebug(LOG_RECOVERY) << "Wireless stack check seems to have failed, retrying...";
 
     } else if(--m_installTryCount > 0) {
         qCDebug(LOG_RECOVERY) << "Wireless stack installation seems to have failed, retrying...";
 
-        m_loopTimer->stop();
-
         setOperationState(Ready);
         advanceOperationState();
 
@@ -212,3 +224,54 @@ void WirelessStackDownloadOperation::tryAgain()
         finishWithError(BackendError::RecoveryError, QStringLiteral("Could not install wireless stack after several tries, giving up"));
     }
 }
+
+void WirelessStackDownloadOperation::startPolling(qint64 deadline)
+{
+    m_pollInterval = POLL_INTERVAL_MIN_MS;
+    m_pollCount = 0;
+    m_pollDeadline = deadline;
+    m_pollTimer.start();
+
+    schedulePoll();
+}
+
+bool WirelessStackDownloadOperation::schedulePoll()
+{
+    if(m_pollTimer.elapsed() >= m_pollDeadline) {
+        qCDebug(LOG_RECOVERY).noquote() << QStringLiteral("%1 gave up after %2 ms, %3 polls")
+                                           .arg(pollingPhaseName()).arg(m_pollTimer.elapsed()).arg(m_pollCount);
+        return false;
+    }
+
+    // Never wait past the deadline, poll one last time right at it instead
+    const auto remaining = m_pollDeadline - m_pollTimer.elapsed();
+    m_loopTimer->start((int)qMin<qint64>(m_pollInterval, remaining));
+
+    m_pollInterval = qMin(m_pollInterval * 2, POLL_INTERVAL_MAX_MS);
+    ++m_pollCount;
+
+    return true;
+}
+
+void WirelessStackDownloadOperation::stopPolling()
+{
+    m_loopTimer->stop();
+
+    // Time-to-ready of each FUS phase, useful for tuning the polling parameters
+    qCDebug(LOG_RECOVERY).noquote() << QStringLiteral("%1 ready after %2 ms, %3 polls")
+                                       .arg(pollingPhaseName()).arg(m_pollTimer.elapsed()).arg(m_pollCount);
+}
+
+const QString WirelessStackDownloadOperation::pollingPhaseName() const
+{
+    switch(operationState()) {
+    case DeletingWirelessStack:
+        return QStringLiteral("Wireless Stack removal");
+    case UpgradingWirelessStack:
+        return QStringLiteral("Wireless Stack upgrade");
+    case CheckingWirelessStack:
+        return QStringLiteral("Wireless Stack check");
+    default:
+        return QStringLiteral("FUS state %1").arg(operationState());
+    }
+}
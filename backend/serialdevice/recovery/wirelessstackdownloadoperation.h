@@ -2,6 +2,8 @@
 
 #include "abstractrecoveryoperation.h"
 
+#include <QElapsedTimer>
+
 class QTimer;
 class QIODevice;
 
@@ -39,11 +41,20 @@ private:
     bool isWirelessStackOK();
     void tryAgain();
 
+    // Poll the FUS state starting fast, backing off exponentially until the deadline
+    void startPolling(qint64 deadline);
+    bool schedulePoll();
+    void stopPolling();
+    const QString pollingPhaseName() const;
+
     QIODevice *m_file;
     QTimer *m_loopTimer;
+    QElapsedTimer m_pollTimer;
     uint32_t m_targetAddress;
     int m_installTryCount;
-    int m_checkTryCount;
+    int m_pollInterval;
+    int m_pollCount;
+    qint64 m_pollDeadline;
 };
 
 }
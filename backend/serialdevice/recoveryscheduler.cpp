@@ -0,0 +1,84 @@
+#include "recoveryscheduler.h"
+
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "recovery.h"
+
+Q_LOGGING_CATEGORY(LOG_RECSCHED, "RSC")
+
+// USB 2.0 Full Speed devices share the host controller bandwidth, more threads do not help.
+// The jobs mostly wait for USB transfers, so the CPU count is not a limit here.
+#define MAX_CONCURRENT_DEVICES 4
+
+using namespace Flipper;
+using namespace Zero;
+
+RecoveryScheduler::RecoveryScheduler()
+{
+    m_pool.setMaxThreadCount(MAX_CONCURRENT_DEVICES);
+}
+
+RecoveryScheduler *RecoveryScheduler::instance()
+{
+    static RecoveryScheduler instance;
+    return &instance;
+}
+
+QFuture<bool> RecoveryScheduler::run(Recovery *recovery, const std::function<bool()> &job)
+{
+    // Checked in the caller's thread, the running job owns the Recovery's error state
+    if(!lock(recovery)) {
+        qCWarning(LOG_RECSCHED) << "Refusing to run concurrent jobs on the same device";
+        return QFuture<bool>();
+    }
+
+    return QtConcurrent::run(&m_pool, [this, recovery, job]() {
+        QElapsedTimer timer;
+        timer.start();
+
+        const auto success = job();
+        const auto busyCount = unlock(recovery);
+
+        qCDebug(LOG_RECSCHED).noquote() << QStringLiteral("Job finished in %1 ms, %2 other device(s) busy")
+                                           .arg(timer.elapsed()).arg(busyCount);
+        return success;
+    });
+}
+
+bool RecoveryScheduler::lock(Recovery *recovery)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if(m_busy.contains(recovery)) {
+        return false;
+    }
+
+    m_busy.insert(recovery);
+    return true;
+}
+
+int RecoveryScheduler::unlock(Recovery *recovery)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // The operation has finished while the job was still running
+    if(m_pendingSessionEnds.remove(recovery)) {
+        recovery->endSession();
+    }
+
+    m_busy.remove(recovery);
+    return m_busy.size();
+}
+
+void RecoveryScheduler::endSession(Recovery *recovery)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if(m_busy.contains(recovery)) {
+        m_pendingSessionEnds.insert(recovery);
+    } else {
+        recovery->endSession();
+    }
+}
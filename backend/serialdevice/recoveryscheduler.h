@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QSet>
+#include <QMutex>
+#include <QFuture>
+#include <QThreadPool>
+
+#include <functional>
+
+namespace Flipper {
+namespace Zero {
+
+class Recovery;
+
+/*
+ * Runs the blocking DFU work of all devices in recovery mode on a bounded thread pool,
+ * so that several devices can be flashed at once without spawning a thread per device.
+ *
+ * Each Recovery instance owns its own USB session, and the scheduler makes sure
+ * that at most one job per Recovery instance is running at any given time.
+ */
+
+class RecoveryScheduler
+{
+    RecoveryScheduler();
+
+public:
+    static RecoveryScheduler *instance();
+
+    // Returns a canceled future, leaving the Recovery untouched, if a job is already running on it
+    QFuture<bool> run(Recovery *recovery, const std::function<bool()> &job);
+
+    // Releases the USB session of the Recovery without blocking on its running job:
+    // if there is one, the session is released by the pool thread once the job has finished
+    void endSession(Recovery *recovery);
+
+private:
+    bool lock(Recovery *recovery);
+    // Returns the number of devices still busy
+    int unlock(Recovery *recovery);
+
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    QSet<Recovery*> m_busy;
+    QSet<Recovery*> m_pendingSessionEnds;
+};
+
+}
+}
+
+#define globalRecoveryScheduler (Flipper::Zero::RecoveryScheduler::instance())
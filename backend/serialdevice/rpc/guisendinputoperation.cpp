@@ -6,17 +6,45 @@ using namespace Flipper;
 using namespace Zero;
 
 GuiSendInputOperation::GuiSendInputOperation(uint32_t id, int key, int type, QObject *parent):
+    GuiSendInputOperation(id, InputEventList {qMakePair(key, type)}, parent)
+{}
+
+GuiSendInputOperation::GuiSendInputOperation(uint32_t id, const InputEventList &events, QObject *parent):
     AbstractProtobufOperation(id, parent),
-    m_key(key),
-    m_type(type)
+    m_events(events),
+    m_sentCount(0),
+    m_responseCount(0)
 {}
 
 const QString GuiSendInputOperation::description() const
 {
-    return QStringLiteral("Gui Send Input");
+    return QStringLiteral("Gui Send Input (%1 events)").arg(m_events.size());
 }
 
 const QByteArray GuiSendInputOperation::encodeRequest(ProtobufPluginInterface *encoder)
 {
-    return encoder->guiSendInput(id(), m_key, m_type);
+    const auto &event = m_events.at(m_sentCount++);
+    return encoder->guiSendInput(id(), event.first, event.second);
+}
+
+bool GuiSendInputOperation::hasMoreData() const
+{
+    return m_sentCount < m_events.size();
+}
+
+void GuiSendInputOperation::feedResponse(QObject *response)
+{
+    ++m_responseCount;
+    AbstractProtobufOperation::feedResponse(response);
+}
+
+void GuiSendInputOperation::finish()
+{
+    // The device replies to each event separately, finish on the last reply only
+    if(!isError() && m_responseCount < m_events.size()) {
+        startTimeout();
+        return;
+    }
+
+    AbstractProtobufOperation::finish();
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <QPair>
+#include <QVector>
+
 #include "abstractprotobufoperation.h"
 
 namespace Flipper {
@@ -10,15 +13,24 @@ class GuiSendInputOperation : public AbstractProtobufOperation
     Q_OBJECT
 
 public:
+    // Pairs of (key, type)
+    using InputEventList = QVector<QPair<int, int>>;
+
     GuiSendInputOperation(uint32_t id, int key, int type, QObject *parent = nullptr);
+    // All events are written at once and share the command id
+    GuiSendInputOperation(uint32_t id, const InputEventList &events, QObject *parent = nullptr);
+
     const QString description() const override;
     const QByteArray encodeRequest(ProtobufPluginInterface *encoder) override;
+    bool hasMoreData() const override;
+    void feedResponse(QObject *response) override;
+    void finish() override;
 
 private:
-    int m_key;
-    int m_type;
+    InputEventList m_events;
+    int m_sentCount;
+    int m_responseCount;
 };
 
 }
 }
-
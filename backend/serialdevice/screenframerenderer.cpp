@@ -0,0 +1,227 @@
+#include "screenframerenderer.h"
+
+#include <cstring>
+
+#include "screenstreamer.h"
+#include "screenframeconverter.h"
+
+#define MAX_SCALE 32
+
+using namespace Flipper;
+using namespace Zero;
+
+static inline quint32 cacheKey(int scale, Qt::ScreenOrientation orientation)
+{
+    return ((quint32)orientation << 16) | (quint32)scale;
+}
+
+static inline bool bitAt(const QByteArray &bitmap, int width, int x, int y)
+{
+    return bitmap.at((y * width + x) / 8) & (1 << (x % 8));
+}
+
+ScreenFrameRenderer::ScreenFrameRenderer(ScreenStreamer *streamer, QObject *parent):
+    QObject(parent),
+    m_streamer(streamer),
+    m_foreground(0xff000000),
+    m_background(0xffff8200),
+    m_generation(0)
+{
+    connect(m_streamer, &ScreenStreamer::screenFrameChanged, this, &ScreenFrameRenderer::onScreenFrameChanged);
+    onScreenFrameChanged();
+}
+
+quint32 ScreenFrameRenderer::foregroundColor() const
+{
+    return m_foreground;
+}
+
+void ScreenFrameRenderer::setForegroundColor(quint32 color)
+{
+    if(color == m_foreground) {
+        return;
+    }
+
+    m_foreground = color;
+    m_lookupTables.clear();
+
+    invalidate();
+    emit colorsChanged();
+}
+
+quint32 ScreenFrameRenderer::backgroundColor() const
+{
+    return m_background;
+}
+
+void ScreenFrameRenderer::setBackgroundColor(quint32 color)
+{
+    if(color == m_background) {
+        return;
+    }
+
+    m_background = color;
+    m_lookupTables.clear();
+
+    invalidate();
+    emit colorsChanged();
+}
+
+ScreenImage ScreenFrameRenderer::image(int scale, Qt::ScreenOrientation orientation)
+{
+    const auto &frame = m_streamer->screenFrame();
+
+    if(m_bitmap.isEmpty()) {
+        return ScreenImage();
+    } else if(orientation == Qt::PrimaryOrientation) {
+        orientation = frame.orientation;
+    }
+
+    scale = qBound(1, scale, MAX_SCALE);
+
+    auto &entry = m_cache[cacheKey(scale, orientation)];
+
+    if(entry.generation == m_generation && !entry.image.pixelData.isEmpty()) {
+        return entry.image;
+    }
+
+    QSize size;
+    const auto bitmap = rotatedBitmap(orientation, size);
+    const auto imageSize = size * scale;
+
+    // Only the changed rows need to be redrawn if the cached image holds the previous frame
+    const auto isPartial = (entry.generation + 1 == m_generation) && m_dirtyRect.isValid() &&
+                           (orientation == Qt::LandscapeOrientation) && (entry.image.size == imageSize);
+
+    // Reuses the buffer unless a consumer still holds a reference to it
+    if(entry.image.size != imageSize) {
+        entry.image.size = imageSize;
+        entry.image.pixelData = QByteArray(imageSize.width() * imageSize.height() * (int)sizeof(quint32), Qt::Uninitialized);
+    }
+
+    if(isPartial) {
+        render(entry.image, bitmap, size, scale, m_dirtyRect.top(), m_dirtyRect.bottom());
+    } else {
+        render(entry.image, bitmap, size, scale, 0, size.height() - 1);
+    }
+
+    entry.generation = m_generation;
+    return entry.image;
+}
+
+void ScreenFrameRenderer::onScreenFrameChanged()
+{
+    const auto &frame = m_streamer->screenFrame();
+
+    m_bitmap = ScreenFrameConverter::toVirtualDisplay(frame.pixelData, frame.size.width(), frame.size.height());
+    m_dirtyRect = frame.dirtyRect;
+    ++m_generation;
+
+    emit imageChanged();
+}
+
+const QVector<quint32> &ScreenFrameRenderer::scaledLookupTable(int scale)
+{
+    auto it = m_lookupTables.find(scale);
+
+    if(it != m_lookupTables.end()) {
+        return *it;
+    }
+
+    // Each source byte expands into 8 * scale pixels
+    QVector<quint32> table(256 * 8 * scale);
+    auto *p = table.data();
+
+    for(auto byte = 0; byte < 256; ++byte) {
+        for(auto bit = 0; bit < 8; ++bit) {
+            const auto color = (byte & (1 << bit)) ? m_foreground : m_background;
+
+            for(auto i = 0; i < scale; ++i) {
+                *(p++) = color;
+            }
+        }
+    }
+
+    return *m_lookupTables.insert(scale, table);
+}
+
+QByteArray ScreenFrameRenderer::rotatedBitmap(Qt::ScreenOrientation orientation, QSize &size) const
+{
+    const auto &frameSize = m_streamer->screenFrame().size;
+    const auto width = frameSize.width();
+    const auto height = frameSize.height();
+
+    if(orientation == Qt::PortraitOrientation || orientation == Qt::InvertedPortraitOrientation) {
+        size = QSize(height, width);
+    } else {
+        size = frameSize;
+    }
+
+    if(orientation == Qt::LandscapeOrientation || orientation == Qt::PrimaryOrientation) {
+        return m_bitmap;
+    }
+
+    QByteArray out((width * height) / 8, 0x0);
+    auto *dst = out.data();
+
+    for(auto y = 0; y < size.height(); ++y) {
+        for(auto x = 0; x < size.width(); ++x) {
+            bool isSet;
+
+            if(orientation == Qt::InvertedLandscapeOrientation) {
+                isSet = bitAt(m_bitmap, width, width - 1 - x, height - 1 - y);
+            } else if(orientation == Qt::PortraitOrientation) {
+                isSet = bitAt(m_bitmap, width, y, height - 1 - x);
+            } else {
+                isSet = bitAt(m_bitmap, width, width - 1 - y, x);
+            }
+
+            if(isSet) {
+                const auto idx = y * size.width() + x;
+                dst[idx / 8] |= (1 << (idx % 8));
+            }
+        }
+    }
+
+    return out;
+}
+
+void ScreenFrameRenderer::render(ScreenImage &image, const QByteArray &bitmap, const QSize &size, int scale, int firstRow, int lastRow)
+{
+    const auto &table = scaledLookupTable(scale);
+
+    const auto bytesPerRow = size.width() / 8;
+    const auto pixelsPerByte = 8 * scale;
+    const auto scanlinePixels = size.width() * scale;
+    const auto scanlineSize = (size_t)scanlinePixels * sizeof(quint32);
+
+    const auto *src = (const quint8*)bitmap.constData();
+    const auto *lut = table.constData();
+
+    // Detaches (keeping the previous contents) if the buffer is shared with a consumer
+    auto *dst = (quint32*)image.pixelData.data();
+
+    firstRow = qMax(firstRow, 0);
+    lastRow = qMin(lastRow, size.height() - 1);
+
+    for(auto y = firstRow; y <= lastRow; ++y) {
+        auto *line = dst + (size_t)y * scale * scanlinePixels;
+
+        for(auto i = 0; i < bytesPerRow; ++i) {
+            memcpy(line + i * pixelsPerByte, lut + src[y * bytesPerRow + i] * pixelsPerByte, pixelsPerByte * sizeof(quint32));
+        }
+
+        // Vertical scaling repeats the expanded scanline
+        for(auto i = 1; i < scale; ++i) {
+            memcpy(line + (size_t)i * scanlinePixels, line, scanlineSize);
+        }
+    }
+}
+
+void ScreenFrameRenderer::invalidate()
+{
+    m_cache.clear();
+    ++m_generation;
+
+    emit imageChanged();
+}
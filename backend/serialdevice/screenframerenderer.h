@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QSize>
+#include <QHash>
+#include <QObject>
+#include <QVector>
+#include <QByteArray>
+
+#include "screenframe.h"
+
+namespace Flipper {
+namespace Zero {
+
+class ScreenStreamer;
+
+/*
+ * Expands 1bpp screen frames into 32bpp ARGB images once per frame and
+ * scale/orientation combination, so that multiple consumers do not
+ * repeat the work on every repaint.
+ *
+ * The backend does not link QtGui, hence the images are plain buffers
+ * that can be wrapped into a QImage (Format_ARGB32) without copying.
+ */
+
+struct ScreenImage {
+    QByteArray pixelData;
+    QSize size;
+};
+
+class ScreenFrameRenderer : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(quint32 foregroundColor READ foregroundColor WRITE setForegroundColor NOTIFY colorsChanged)
+    Q_PROPERTY(quint32 backgroundColor READ backgroundColor WRITE setBackgroundColor NOTIFY colorsChanged)
+
+public:
+    ScreenFrameRenderer(ScreenStreamer *streamer, QObject *parent = nullptr);
+
+    // Colors are in 0xAARRGGBB format
+    quint32 foregroundColor() const;
+    void setForegroundColor(quint32 color);
+
+    quint32 backgroundColor() const;
+    void setBackgroundColor(quint32 color);
+
+    // Returns the current frame at an integer scale factor, rendering it on first request.
+    // Frame width and height must be multiples of 8.
+    Q_INVOKABLE ScreenImage image(int scale, Qt::ScreenOrientation orientation = Qt::PrimaryOrientation);
+
+signals:
+    void imageChanged();
+    void colorsChanged();
+
+private slots:
+    void onScreenFrameChanged();
+
+private:
+    struct CacheEntry {
+        ScreenImage image;
+        quint64 generation = 0;
+    };
+
+    const QVector<quint32> &scaledLookupTable(int scale);
+    QByteArray rotatedBitmap(Qt::ScreenOrientation orientation, QSize &size) const;
+    void render(ScreenImage &image, const QByteArray &bitmap, const QSize &size, int scale, int firstRow, int lastRow);
+    void invalidate();
+
+    ScreenStreamer *m_streamer;
+
+    quint32 m_foreground;
+    quint32 m_background;
+
+    // Bitmap of the current frame in row-major (VirtualDisplay) layout
+    QByteArray m_bitmap;
+    QRect m_dirtyRect;
+    quint64 m_generation;
+
+    QHash<int, QVector<quint32>> m_lookupTables;
+    QHash<quint32, CacheEntry> m_cache;
+};
+
+}
+}
+
+Q_DECLARE_METATYPE(Flipper::Zero::ScreenImage)
@@ -0,0 +1,302 @@
+#include "screenplayer.h"
+
+#include <QDebug>
+#include <QLoggingCategory>
+
+#include <algorithm>
+
+Q_DECLARE_LOGGING_CATEGORY(LOG_RECORDER)
+
+using namespace Flipper;
+using namespace Zero;
+
+ScreenPlayer::ScreenPlayer(QObject *parent):
+    QObject(parent),
+    m_timer(new QTimer(this)),
+    m_dataEnd(0),
+    m_duration(0),
+    m_position(0),
+    m_isPlaying(false)
+{
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &ScreenPlayer::onPlaybackTimeout);
+}
+
+const ScreenFrame &ScreenPlayer::screenFrame() const
+{
+    return m_screenFrame;
+}
+
+qint64 ScreenPlayer::position() const
+{
+    return m_position;
+}
+
+qint64 ScreenPlayer::duration() const
+{
+    return m_duration;
+}
+
+bool ScreenPlayer::isPlaying() const
+{
+    return m_isPlaying;
+}
+
+bool ScreenPlayer::open(const QUrl &fileUrl)
+{
+    close();
+    clearError();
+
+    m_file.setFileName(fileUrl.toLocalFile());
+
+    if(!m_file.open(QIODevice::ReadOnly)) {
+        setError(BackendError::DiskError, m_file.errorString());
+        return false;
+    }
+
+    ScreenRecording::FileHeader header;
+
+    if(m_file.read((char*)&header, sizeof(header)) != sizeof(header) || header.magic != ScreenRecording::FILE_MAGIC) {
+        setError(BackendError::DataError, QStringLiteral("Not a screen recording file"));
+    } else if(header.version != ScreenRecording::VERSION) {
+        setError(BackendError::DataError, QStringLiteral("Unsupported screen recording version"));
+    } else if(!readIndex() && !buildIndex()) {
+        setError(BackendError::DataError, QStringLiteral("Screen recording is corrupted"));
+    }
+
+    if(isError()) {
+        m_file.close();
+        return false;
+    }
+
+    m_screenFrame.size = QSize(header.width, header.height);
+    m_screenFrame.orientation = Qt::LandscapeOrientation;
+    m_pixelData = QByteArray((header.width * header.height) / 8, 0x0);
+
+    emit durationChanged();
+
+    seek(0);
+    return true;
+}
+
+void ScreenPlayer::close()
+{
+    setPlaying(false);
+
+    m_file.close();
+    m_index.clear();
+    m_dataEnd = 0;
+    m_duration = 0;
+    m_position = 0;
+}
+
+void ScreenPlayer::play()
+{
+    if(!m_file.isOpen() || m_isPlaying) {
+        return;
+    } else if(m_position >= m_duration) {
+        seek(0);
+    }
+
+    setPlaying(true);
+    scheduleNextFrame();
+}
+
+void ScreenPlayer::pause()
+{
+    setPlaying(false);
+}
+
+void ScreenPlayer::seek(qint64 msecs)
+{
+    if(m_index.isEmpty()) {
+        return;
+    }
+
+    msecs = qBound<qint64>(0, msecs, m_duration);
+
+    // Start decoding at the last keyframe not later than the requested position
+    auto it = std::upper_bound(m_index.cbegin(), m_index.cend(), msecs, [](qint64 ms, const ScreenRecording::IndexEntry &entry) {
+        return ms < entry.timestamp;
+    });
+
+    if(it != m_index.cbegin()) {
+        --it;
+    }
+
+    m_file.seek(it->offset);
+
+    quint32 timestamp;
+    while(peekTimestamp(timestamp) && (timestamp <= msecs || m_file.pos() == it->offset)) {
+        if(!readFrame()) {
+            setPlaying(false);
+            return;
+        }
+    }
+
+    m_position = msecs;
+    emit positionChanged();
+    emit screenFrameChanged();
+
+    if(m_isPlaying) {
+        scheduleNextFrame();
+    }
+}
+
+void ScreenPlayer::onPlaybackTimeout()
+{
+    if(!readFrame()) {
+        setPlaying(false);
+        return;
+    }
+
+    emit positionChanged();
+    emit screenFrameChanged();
+
+    scheduleNextFrame();
+}
+
+bool ScreenPlayer::readIndex()
+{
+    ScreenRecording::IndexTrailer trailer;
+
+    const auto trailerPos = m_file.size() - (qint64)sizeof(trailer);
+
+    if(trailerPos < (qint64)sizeof(ScreenRecording::FileHeader) || !m_file.seek(trailerPos) ||
+       m_file.read((char*)&trailer, sizeof(trailer)) != sizeof(trailer) || trailer.magic != ScreenRecording::INDEX_MAGIC) {
+        return false;
+    }
+
+    const auto indexSize = (qint64)trailer.entryCount * (qint64)sizeof(ScreenRecording::IndexEntry);
+    const auto indexPos = trailerPos - indexSize;
+
+    if(trailer.entryCount == 0 || indexPos < (qint64)sizeof(ScreenRecording::FileHeader) || !m_file.seek(indexPos)) {
+        return false;
+    }
+
+    m_index.resize(trailer.entryCount);
+
+    if(m_file.read((char*)m_index.data(), indexSize) != indexSize) {
+        m_index.clear();
+        return false;
+    }
+
+    m_dataEnd = indexPos;
+    m_duration = trailer.duration;
+
+    return true;
+}
+
+bool ScreenPlayer::buildIndex()
+{
+    // The recording was not finalized, recover what was written
+    qCDebug(LOG_RECORDER) << "Screen recording index is missing, scanning the frames...";
+
+    m_index.clear();
+    m_dataEnd = m_file.size();
+
+    auto pos = (qint64)sizeof(ScreenRecording::FileHeader);
+    ScreenRecording::FrameHeader header;
+
+    while(m_file.seek(pos) && m_file.read((char*)&header, sizeof(header)) == sizeof(header)) {
+        const auto next = pos + (qint64)sizeof(header) + header.payloadSize;
+
+        if(next > m_dataEnd) {
+            break;
+        } else if(header.type == ScreenRecording::KeyFrame) {
+            m_index.append({(quint32)pos, header.timestamp});
+        }
+
+        m_duration = header.timestamp;
+        pos = next;
+    }
+
+    m_dataEnd = pos;
+    return !m_index.isEmpty();
+}
+
+bool ScreenPlayer::peekTimestamp(quint32 &timestamp)
+{
+    ScreenRecording::FrameHeader header;
+
+    if(m_file.pos() + (qint64)sizeof(header) > m_dataEnd || m_file.peek((char*)&header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+
+    timestamp = header.timestamp;
+    return true;
+}
+
+bool ScreenPlayer::readFrame()
+{
+    ScreenRecording::FrameHeader header;
+
+    if(m_file.pos() + (qint64)sizeof(header) > m_dataEnd || m_file.read((char*)&header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+
+    m_payload.resize(header.payloadSize);
+
+    if(m_file.read(m_payload.data(), header.payloadSize) != header.payloadSize) {
+        return false;
+    }
+
+    if(header.type == ScreenRecording::KeyFrame) {
+        // The recorder starts a new keyframe whenever the bitmap size changes
+        const auto pixelDataSize = ScreenRecording::decodedSizeRLE(m_payload.constData(), m_payload.size());
+
+        if(pixelDataSize < 0) {
+            return false;
+        }
+
+        m_pixelData.resize(pixelDataSize);
+
+        if(!ScreenRecording::decodeRLE(m_payload.constData(), m_payload.size(), m_pixelData)) {
+            return false;
+        }
+
+    } else {
+        QByteArray delta(m_pixelData.size(), Qt::Uninitialized);
+
+        if(!ScreenRecording::decodeRLE(m_payload.constData(), m_payload.size(), delta)) {
+            return false;
+        }
+
+        ScreenRecording::xorInPlace(m_pixelData, delta);
+    }
+
+    m_screenFrame.pixelData = m_pixelData;
+    m_screenFrame.orientation = (Qt::ScreenOrientation)header.orientation;
+    m_screenFrame.dirtyRect = QRect();
+    m_position = header.timestamp;
+
+    return true;
+}
+
+void ScreenPlayer::scheduleNextFrame()
+{
+    quint32 timestamp;
+
+    if(!m_isPlaying) {
+        return;
+    } else if(!peekTimestamp(timestamp)) {
+        setPlaying(false);
+        return;
+    }
+
+    m_timer->start(qMax<qint64>(0, timestamp - m_position));
+}
+
+void ScreenPlayer::setPlaying(bool set)
+{
+    if(!set) {
+        m_timer->stop();
+    }
+
+    if(set == m_isPlaying) {
+        return;
+    }
+
+    m_isPlaying = set;
+    emit isPlayingChanged();
+}
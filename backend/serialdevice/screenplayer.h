@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QUrl>
+#include <QFile>
+#include <QTimer>
+#include <QObject>
+#include <QVector>
+
+#include "failable.h"
+#include "screenframe.h"
+#include "screenrecording.h"
+
+namespace Flipper {
+namespace Zero {
+
+class ScreenPlayer : public QObject, public Failable
+{
+    Q_OBJECT
+    Q_PROPERTY(ScreenFrame screenFrame READ screenFrame NOTIFY screenFrameChanged)
+    Q_PROPERTY(qint64 position READ position NOTIFY positionChanged)
+    Q_PROPERTY(qint64 duration READ duration NOTIFY durationChanged)
+    Q_PROPERTY(bool isPlaying READ isPlaying NOTIFY isPlayingChanged)
+
+public:
+    ScreenPlayer(QObject *parent = nullptr);
+
+    const ScreenFrame &screenFrame() const;
+    qint64 position() const;
+    qint64 duration() const;
+    bool isPlaying() const;
+
+    Q_INVOKABLE bool open(const QUrl &fileUrl);
+    Q_INVOKABLE void close();
+
+signals:
+    void screenFrameChanged();
+    void positionChanged();
+    void durationChanged();
+    void isPlayingChanged();
+
+public slots:
+    void play();
+    void pause();
+    void seek(qint64 msecs);
+
+private slots:
+    void onPlaybackTimeout();
+
+private:
+    bool readIndex();
+    bool buildIndex();
+
+    bool peekTimestamp(quint32 &timestamp);
+    bool readFrame();
+    void scheduleNextFrame();
+    void setPlaying(bool set);
+
+    QFile m_file;
+    QTimer *m_timer;
+
+    QVector<ScreenRecording::IndexEntry> m_index;
+    qint64 m_dataEnd;
+    qint64 m_duration;
+    qint64 m_position;
+
+    ScreenFrame m_screenFrame;
+    QByteArray m_pixelData;
+    QByteArray m_payload;
+    bool m_isPlaying;
+};
+
+}
+}
@@ -0,0 +1,187 @@
+#include "screenrecorder.h"
+
+#include <QFile>
+#include <QDebug>
+#include <QThread>
+#include <QLoggingCategory>
+
+#include "screenstreamer.h"
+
+Q_DECLARE_LOGGING_CATEGORY(LOG_RECORDER)
+
+#define QUEUE_CAPACITY 64
+#define WAKEUP_INTERVAL_MS 250
+
+using namespace Flipper;
+using namespace Zero;
+
+ScreenRecorder::ScreenRecorder(ScreenStreamer *streamer, QObject *parent):
+    QObject(parent),
+    m_streamer(streamer),
+    m_file(nullptr),
+    m_writerThread(nullptr),
+    m_queue(QUEUE_CAPACITY),
+    m_queueHead(0),
+    m_queueTail(0),
+    m_isStopping(0),
+    m_droppedFrameCount(0),
+    m_isWriteError(false)
+{}
+
+ScreenRecorder::~ScreenRecorder()
+{
+    stop();
+}
+
+bool ScreenRecorder::isRecording() const
+{
+    return m_writerThread != nullptr;
+}
+
+int ScreenRecorder::droppedFrameCount() const
+{
+    return m_droppedFrameCount.loadAcquire();
+}
+
+bool ScreenRecorder::start(const QUrl &fileUrl)
+{
+    if(isRecording()) {
+        qCDebug(LOG_RECORDER) << "Screen recording is already running";
+        return false;
+    }
+
+    clearError();
+
+    const auto &frame = m_streamer->screenFrame();
+
+    if(frame.size.isEmpty()) {
+        setError(BackendError::UnknownError, QStringLiteral("No screen frame to record"));
+        return false;
+    }
+
+    m_file = new QFile(fileUrl.toLocalFile());
+
+    if(!m_file->open(QIODevice::WriteOnly)) {
+        setError(BackendError::DiskError, m_file->errorString());
+        qCDebug(LOG_RECORDER).noquote() << "Failed to start screen recording:" << errorString();
+
+        delete m_file;
+        m_file = nullptr;
+        return false;
+    }
+
+    m_isWriteError = !m_writer.begin(m_file, frame.size);
+
+    m_queueHead.storeRelease(0);
+    m_queueTail.storeRelease(0);
+    m_isStopping.storeRelease(0);
+    m_droppedFrameCount.storeRelease(0);
+
+    m_elapsed.start();
+
+    m_writerThread = QThread::create([this]() {
+        writeFrames();
+    });
+
+    m_writerThread->start(QThread::LowPriority);
+
+    // Record the current screen so that playback does not start blank
+    enqueueFrame({0, frame});
+
+    connect(m_streamer, &ScreenStreamer::screenFrameChanged, this, &ScreenRecorder::onScreenFrameChanged);
+
+    emit isRecordingChanged();
+    return true;
+}
+
+void ScreenRecorder::stop()
+{
+    if(!isRecording()) {
+        return;
+    }
+
+    disconnect(m_streamer, &ScreenStreamer::screenFrameChanged, this, &ScreenRecorder::onScreenFrameChanged);
+
+    m_isStopping.storeRelease(1);
+    m_queueSignal.release();
+
+    m_writerThread->wait();
+    delete m_writerThread;
+    m_writerThread = nullptr;
+
+    if(m_isWriteError) {
+        setError(BackendError::DiskError, m_file->errorString());
+        qCDebug(LOG_RECORDER).noquote() << "Screen recording failed:" << errorString();
+    }
+
+    qCDebug(LOG_RECORDER).noquote() << "Screen recording stopped:" << m_file->size() << "bytes," << m_writer.keyFrameCount()
+                                    << "keyframes," << droppedFrameCount() << "frames dropped";
+    m_file->close();
+    delete m_file;
+    m_file = nullptr;
+
+    emit isRecordingChanged();
+}
+
+void ScreenRecorder::onScreenFrameChanged()
+{
+    if(!enqueueFrame({(quint32)m_elapsed.elapsed(), m_streamer->screenFrame()})) {
+        m_droppedFrameCount.ref();
+    }
+}
+
+bool ScreenRecorder::enqueueFrame(const QueuedFrame &frame)
+{
+    const auto head = m_queueHead.loadAcquire();
+    const auto next = (head + 1) % QUEUE_CAPACITY;
+
+    if(next == m_queueTail.loadAcquire()) {
+        return false;
+    }
+
+    m_queue[head] = frame;
+    m_queueHead.storeRelease(next);
+    m_queueSignal.release();
+
+    return true;
+}
+
+bool ScreenRecorder::dequeueFrame(QueuedFrame &frame)
+{
+    const auto tail = m_queueTail.loadAcquire();
+
+    if(tail == m_queueHead.loadAcquire()) {
+        return false;
+    }
+
+    frame = std::move(m_queue[tail]);
+    m_queue[tail] = QueuedFrame();
+    m_queueTail.storeRelease((tail + 1) % QUEUE_CAPACITY);
+
+    return true;
+}
+
+void ScreenRecorder::writeFrames()
+{
+    QueuedFrame frame;
+
+    for(;;) {
+        m_queueSignal.tryAcquire(1, WAKEUP_INTERVAL_MS);
+
+        while(dequeueFrame(frame)) {
+            if(!m_isWriteError && !m_writer.writeFrame(frame.timestamp, frame.frame)) {
+                m_isWriteError = true;
+            }
+        }
+
+        if(m_isStopping.loadAcquire()) {
+            break;
+        }
+    }
+
+    if(!m_isWriteError && !m_writer.finish()) {
+        m_isWriteError = true;
+    }
+
+    m_file->flush();
+}
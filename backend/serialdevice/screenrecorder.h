@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QUrl>
+#include <QObject>
+#include <QVector>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QElapsedTimer>
+
+#include "failable.h"
+#include "screenframe.h"
+#include "screenrecording.h"
+
+class QFile;
+class QThread;
+
+namespace Flipper {
+namespace Zero {
+
+class ScreenStreamer;
+
+class ScreenRecorder : public QObject, public Failable
+{
+    Q_OBJECT
+    Q_PROPERTY(bool isRecording READ isRecording NOTIFY isRecordingChanged)
+
+public:
+    ScreenRecorder(ScreenStreamer *streamer, QObject *parent = nullptr);
+    ~ScreenRecorder();
+
+    bool isRecording() const;
+
+    // Frames not recorded because the writer thread could not keep up
+    int droppedFrameCount() const;
+
+    Q_INVOKABLE bool start(const QUrl &fileUrl);
+    Q_INVOKABLE void stop();
+
+signals:
+    void isRecordingChanged();
+
+private slots:
+    void onScreenFrameChanged();
+
+private:
+    struct QueuedFrame {
+        quint32 timestamp;
+        ScreenFrame frame;
+    };
+
+    bool enqueueFrame(const QueuedFrame &frame);
+    bool dequeueFrame(QueuedFrame &frame);
+
+    void writeFrames();
+
+    ScreenStreamer *m_streamer;
+    QFile *m_file;
+    QThread *m_writerThread;
+    QElapsedTimer m_elapsed;
+
+    // Single-producer single-consumer ring buffer, the GUI thread only advances
+    // the head and the writer thread only advances the tail
+    QVector<QueuedFrame> m_queue;
+    QAtomicInt m_queueHead;
+    QAtomicInt m_queueTail;
+    QSemaphore m_queueSignal;
+    QAtomicInt m_isStopping;
+    QAtomicInt m_droppedFrameCount;
+
+    // Accessed from the writer thread only while recording
+    ScreenRecordingWriter m_writer;
+    bool m_isWriteError;
+};
+
+}
+}
@@ -0,0 +1,215 @@
+#include "screenrecording.h"
+
+#include <cstring>
+
+#include <QIODevice>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(LOG_RECORDER, "REC")
+
+#define KEYFRAME_INTERVAL 64
+
+using namespace Flipper;
+using namespace Zero;
+
+static_assert(sizeof(ScreenRecording::FileHeader) == 12, "Check FileHeader alignment");
+static_assert(sizeof(ScreenRecording::FrameHeader) == 8, "Check FrameHeader alignment");
+static_assert(sizeof(ScreenRecording::IndexEntry) == 8, "Check IndexEntry alignment");
+static_assert(sizeof(ScreenRecording::IndexTrailer) == 16, "Check IndexTrailer alignment");
+
+#define MAX_RUN_LENGTH 128
+#define MIN_RUN_LENGTH 3
+
+// PackBits-style encoding: control byte c < 0x80 is followed by c + 1 literal bytes,
+// c >= 0x80 is followed by one byte repeated (c & 0x7f) + 1 times.
+QByteArray ScreenRecording::encodeRLE(const QByteArray &data)
+{
+    QByteArray out;
+    out.reserve(data.size() / 4);
+
+    const auto *p = (const quint8*)data.constData();
+    const auto size = data.size();
+
+    auto literalStart = 0;
+
+    const auto flushLiterals = [&](int end) {
+        while(literalStart < end) {
+            const auto n = qMin(end - literalStart, MAX_RUN_LENGTH);
+            out.append((char)(n - 1));
+            out.append((const char*)p + literalStart, n);
+            literalStart += n;
+        }
+    };
+
+    for(auto i = 0; i < size;) {
+        auto runLength = 1;
+
+        while(i + runLength < size && runLength < MAX_RUN_LENGTH && p[i + runLength] == p[i]) {
+            ++runLength;
+        }
+
+        if(runLength >= MIN_RUN_LENGTH) {
+            flushLiterals(i);
+            out.append((char)(0x80 | (runLength - 1)));
+            out.append((char)p[i]);
+            i += runLength;
+            literalStart = i;
+        } else {
+            i += runLength;
+        }
+    }
+
+    flushLiterals(size);
+    return out;
+}
+
+bool ScreenRecording::decodeRLE(const char *data, int size, QByteArray &out)
+{
+    const auto *p = (const quint8*)data;
+    auto *dst = out.data();
+
+    const auto outSize = out.size();
+    auto pos = 0;
+
+    for(auto i = 0; i < size;) {
+        const auto c = p[i++];
+        const auto n = (c & 0x7f) + 1;
+
+        if(pos + n > outSize) {
+            return false;
+
+        } else if(c & 0x80) {
+            if(i >= size) {
+                return false;
+            }
+
+            memset(dst + pos, p[i++], n);
+
+        } else {
+            if(i + n > size) {
+                return false;
+            }
+
+            memcpy(dst + pos, p + i, n);
+            i += n;
+        }
+
+        pos += n;
+    }
+
+    return pos == outSize;
+}
+
+int ScreenRecording::decodedSizeRLE(const char *data, int size)
+{
+    const auto *p = (const quint8*)data;
+    auto outSize = 0;
+
+    for(auto i = 0; i < size;) {
+        const auto c = p[i++];
+        const auto n = (c & 0x7f) + 1;
+
+        // Either one repeated byte or n literal bytes follow
+        i += (c & 0x80) ? 1 : n;
+
+        if(i > size) {
+            return -1;
+        }
+
+        outSize += n;
+    }
+
+    return outSize;
+}
+
+void ScreenRecording::xorInPlace(QByteArray &dst, const QByteArray &src)
+{
+    const auto size = qMin(dst.size(), src.size());
+
+    auto *d = dst.data();
+    const auto *s = src.constData();
+
+    for(auto i = 0; i < size; ++i) {
+        d[i] ^= s[i];
+    }
+}
+
+ScreenRecordingWriter::ScreenRecordingWriter():
+    m_file(nullptr),
+    m_prevOrientation(Qt::PrimaryOrientation),
+    m_lastTimestamp(0),
+    m_framesSinceKeyFrame(0)
+{}
+
+bool ScreenRecordingWriter::begin(QIODevice *file, const QSize &size)
+{
+    m_file = file;
+    m_prevPixelData.clear();
+    m_prevOrientation = Qt::PrimaryOrientation;
+    m_index.clear();
+    m_lastTimestamp = 0;
+    m_framesSinceKeyFrame = 0;
+
+    ScreenRecording::FileHeader header;
+    header.magic = ScreenRecording::FILE_MAGIC;
+    header.version = ScreenRecording::VERSION;
+    header.reserved = 0;
+    header.width = size.width();
+    header.height = size.height();
+
+    return m_file->write((const char*)&header, sizeof(header)) == sizeof(header);
+}
+
+bool ScreenRecordingWriter::writeFrame(quint32 timestamp, const ScreenFrame &frame)
+{
+    const auto &pixelData = frame.pixelData;
+
+    const auto isKeyFrame = m_prevPixelData.isEmpty() || (m_framesSinceKeyFrame >= KEYFRAME_INTERVAL) ||
+                            (pixelData.size() != m_prevPixelData.size()) ||
+                            (frame.orientation != m_prevOrientation);
+    QByteArray payload;
+
+    if(isKeyFrame) {
+        payload = ScreenRecording::encodeRLE(pixelData);
+        m_index.append({(quint32)m_file->pos(), timestamp});
+        m_framesSinceKeyFrame = 0;
+
+    } else {
+        auto delta = pixelData;
+        ScreenRecording::xorInPlace(delta, m_prevPixelData);
+        payload = ScreenRecording::encodeRLE(delta);
+        ++m_framesSinceKeyFrame;
+    }
+
+    ScreenRecording::FrameHeader header;
+    header.timestamp = timestamp;
+    header.type = isKeyFrame ? ScreenRecording::KeyFrame : ScreenRecording::DeltaFrame;
+    header.orientation = (quint8)frame.orientation;
+    header.payloadSize = payload.size();
+
+    m_prevPixelData = pixelData;
+    m_prevOrientation = frame.orientation;
+    m_lastTimestamp = timestamp;
+
+    return (m_file->write((const char*)&header, sizeof(header)) == sizeof(header)) &&
+           (m_file->write(payload) == payload.size());
+}
+
+bool ScreenRecordingWriter::finish()
+{
+    ScreenRecording::IndexTrailer trailer;
+    trailer.entryCount = m_index.size();
+    trailer.duration = m_lastTimestamp;
+    trailer.reserved = 0;
+    trailer.magic = ScreenRecording::INDEX_MAGIC;
+
+    const auto indexSize = (qint64)(m_index.size() * sizeof(ScreenRecording::IndexEntry));
+
+    return (m_file->write((const char*)m_index.constData(), indexSize) == indexSize) &&
+           (m_file->write((const char*)&trailer, sizeof(trailer)) == sizeof(trailer));
+}
+
+int ScreenRecordingWriter::keyFrameCount() const
+{
+    return m_index.size();
+}
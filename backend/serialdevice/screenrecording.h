@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QSize>
+#include <QVector>
+#include <QByteArray>
+
+#include "screenframe.h"
+
+class QIODevice;
+
+namespace Flipper {
+namespace Zero {
+
+/*
+ * Screen recording file layout (native byte order):
+ *
+ * FileHeader, then a sequence of FrameHeader + payload, then the keyframe index:
+ * IndexEntry for each keyframe followed by IndexTrailer. The index is written
+ * when the recording is stopped, the player rebuilds it if it is missing.
+ *
+ * Keyframe payload is the RLE-encoded bitmap, delta frame payload is the
+ * RLE-encoded XOR of the bitmap with the previous frame.
+ */
+
+class ScreenRecording
+{
+public:
+    enum FrameType : quint8 {
+        KeyFrame,
+        DeltaFrame
+    };
+
+    struct FileHeader {
+        quint32 magic;
+        quint16 version;
+        quint16 reserved;
+        quint16 width;
+        quint16 height;
+    };
+
+    struct FrameHeader {
+        quint32 timestamp;
+        quint8 type;
+        quint8 orientation;
+        quint16 payloadSize;
+    };
+
+    struct IndexEntry {
+        quint32 offset;
+        quint32 timestamp;
+    };
+
+    struct IndexTrailer {
+        quint32 entryCount;
+        quint32 duration;
+        quint32 reserved;
+        quint32 magic;
+    };
+
+    static constexpr quint32 FILE_MAGIC = 0x52535a46; // "FZSR"
+    static constexpr quint32 INDEX_MAGIC = 0x49535a46; // "FZSI"
+    static constexpr quint16 VERSION = 1;
+
+    static QByteArray encodeRLE(const QByteArray &data);
+    static bool decodeRLE(const char *data, int size, QByteArray &out);
+    // Size of the decoded data, -1 if the encoded data is malformed
+    static int decodedSizeRLE(const char *data, int size);
+    static void xorInPlace(QByteArray &dst, const QByteArray &src);
+};
+
+/*
+ * Writes the frames of a recording, keeping the keyframe index
+ * in memory until finish() appends it to the file.
+ */
+
+class ScreenRecordingWriter
+{
+public:
+    ScreenRecordingWriter();
+
+    bool begin(QIODevice *file, const QSize &size);
+    bool writeFrame(quint32 timestamp, const ScreenFrame &frame);
+    bool finish();
+
+    int keyFrameCount() const;
+
+private:
+    QIODevice *m_file;
+    QByteArray m_prevPixelData;
+    Qt::ScreenOrientation m_prevOrientation;
+    QVector<ScreenRecording::IndexEntry> m_index;
+    quint32 m_lastTimestamp;
+    int m_framesSinceKeyFrame;
+};
+
+}
+}
@@ -1,6 +1,9 @@
 #include "screenstreamer.h"
 
+#include <QHash>
 #include <QDebug>
+#include <cstring>
+#include <algorithm>
 #include <QLoggingCategory>
 
 #include "flipperzero.h"
@@ -13,6 +16,8 @@
 
 #include "pixmaps/default.h"
 
+#include "screenframeconverter.h"
+
 Q_LOGGING_CATEGORY(CATEGORY_SCREEN, "SCR")
 
 using namespace Flipper;
@@ -21,32 +26,17 @@ using namespace Zero;
 static constexpr int SCREEN_FRAME_WIDTH = 128;
 static constexpr int SCREEN_FRAME_HEIGHT = 64;
 
-// ScreenStream and VirtualDisplay formats differ
-static QByteArray transposeImage(const QByteArray &in, int width, int height)
-{
-    QByteArray out((width * height) / 8, 0x0);
-
-    for(auto y = 0; y < height; ++y) {
-        for(auto x = 0; x < width; ++x) {
-            const auto ii = (y * width + x) / 8;
-            const auto oi = y / 8 * width + x;
-
-            const auto iz = x % 8;
-            const auto oz = y % 8;
-
-            if(in[ii] & (1 << iz)) {
-                out[oi] = out[oi] | (1 << oz);
-            }
-        }
-    }
-
-    return out;
-}
+static constexpr int MAX_INPUT_BATCH_SIZE = 8;
+static constexpr int MAX_LATENCY_SAMPLES = 1000;
 
 ScreenStreamer::ScreenStreamer(QObject *parent):
     QObject(parent),
     m_streamState(StreamState::Stopped),
-    m_device(nullptr)
+    m_device(nullptr),
+    m_isLatencyProbeEnabled(false),
+    m_isLatencyProbePending(false),
+    m_probeFrameHash(0),
+    m_latencySampleIndex(0)
 {}
 
 void ScreenStreamer::setDevice(SerialDevice *device)
@@ -56,10 +46,11 @@ void ScreenStreamer::setDevice(SerialDevice *device)
     }
 
     setStreamState(StreamState::Stopped);
+    resetPendingInput();
 
     m_device = device;
     setScreenFrame({
-        transposeImage(QByteArray((char*)default_bits, sizeof(default_bits)), default_width, default_height),
+        ScreenFrameConverter::toScreenStream(QByteArray((char*)default_bits, sizeof(default_bits)), default_width, default_height),
         QSize(SCREEN_FRAME_WIDTH, SCREEN_FRAME_HEIGHT),
         Qt::LandscapeOrientation,
     });
@@ -73,16 +64,62 @@ void ScreenStreamer::setDevice(SerialDevice *device)
 
 void ScreenStreamer::sendInputEvent(InputEvent::Key key, InputEvent::Type type)
 {
-    auto *operation = m_device->rpc()->guiSendInput(key, type);
+    if(m_isLatencyProbeEnabled && !m_isLatencyProbePending) {
+        m_isLatencyProbePending = true;
+        m_probeFrameHash = qHash(m_screenData.pixelData);
+        m_probeTimer.start();
+    }
+
+    m_pendingInputEvents.append(qMakePair((int)key, (int)type));
+
+    // Events arriving while a batch is in flight are sent together afterwards
+    if(!m_inputOperation) {
+        sendPendingInputEvents();
+    }
+}
+
+void ScreenStreamer::sendPendingInputEvents()
+{
+    const auto batchSize = qMin(m_pendingInputEvents.size(), MAX_INPUT_BATCH_SIZE);
+    const auto batch = m_pendingInputEvents.mid(0, batchSize);
+    m_pendingInputEvents.remove(0, batchSize);
+
+    auto *operation = m_device->rpc()->guiSendInput(batch);
+    m_inputOperation = operation;
+
+    // Dropped from the queue without finishing, the events waiting for it are stale
+    connect(operation, &QObject::destroyed, this, [=]() {
+        if(!m_inputOperation) {
+            m_pendingInputEvents.clear();
+        }
+    });
 
     connect(operation, &AbstractOperation::finished, this, [=]() {
+        // Input has been reset in the meantime
+        if(m_inputOperation != operation) {
+            return;
+        }
+
+        m_inputOperation.clear();
+
         if(operation->isError()) {
+            m_pendingInputEvents.clear();
             setStreamState(Stopped);
             qCDebug(CATEGORY_SCREEN).noquote() << "Failed to send input event: " << operation->errorString();
+
+        } else if(!m_pendingInputEvents.isEmpty()) {
+            sendPendingInputEvents();
         }
     });
 }
 
+void ScreenStreamer::resetPendingInput()
+{
+    m_pendingInputEvents.clear();
+    m_inputOperation.clear();
+    m_isLatencyProbePending = false;
+}
+
 bool ScreenStreamer::isEnabled() const
 {
     return m_streamState == Running || m_streamState == Paused;
@@ -116,6 +153,35 @@ const ScreenFrame &ScreenStreamer::screenFrame() const
     return m_screenData;
 }
 
+bool ScreenStreamer::isLatencyProbeEnabled() const
+{
+    return m_isLatencyProbeEnabled;
+}
+
+void ScreenStreamer::setLatencyProbeEnabled(bool set)
+{
+    if(set == m_isLatencyProbeEnabled) {
+        return;
+    }
+
+    m_isLatencyProbeEnabled = set;
+    m_isLatencyProbePending = false;
+    m_latencySamples.clear();
+    m_latencySampleIndex = 0;
+
+    emit inputLatencyChanged();
+}
+
+int ScreenStreamer::inputLatencyP50() const
+{
+    return inputLatencyPercentile(0.50);
+}
+
+int ScreenStreamer::inputLatencyP99() const
+{
+    return inputLatencyPercentile(0.99);
+}
+
 void ScreenStreamer::start()
 {
     if(!m_device) {
@@ -126,6 +192,7 @@ void ScreenStreamer::start()
     }
 
     setStreamState(StreamState::Starting);
+    resetPendingInput();
 
     auto *operation = m_device->rpc()->guiStartScreenStream();
 
@@ -164,6 +231,8 @@ void ScreenStreamer::onProtobufSessionStateChanged()
 {
     if(!m_device->rpc()->isSessionUp()) {
         setStreamState(Stopped);
+        // Operations still queued are dropped without finishing
+        resetPendingInput();
     }
 }
 
@@ -176,7 +245,7 @@ void ScreenStreamer::onBroadcastResponseReceived(QObject *response)
     auto *screenFrameResponse = qobject_cast<GuiScreenFrameResponseInterface*>(response);
 
     if(screenFrameResponse) {
-        setScreenFrame({
+        updateScreenFrame({
             screenFrameResponse->screenFrame(),
             QSize(SCREEN_FRAME_WIDTH, SCREEN_FRAME_HEIGHT),
             screenFrameResponse->screenOrientation(),
@@ -199,3 +268,100 @@ void ScreenStreamer::setScreenFrame(const ScreenFrame &frame)
     m_screenData = frame;
     emit screenFrameChanged();
 }
+
+void ScreenStreamer::updateScreenFrame(const ScreenFrame &frame)
+{
+    const auto &prev = m_screenData;
+
+    const auto isComparable = (frame.size == prev.size) && (frame.orientation == prev.orientation) &&
+                              (frame.pixelData.size() == prev.pixelData.size()) &&
+                              (frame.pixelData.size() == (frame.size.width() * frame.size.height()) / 8);
+    if(!isComparable) {
+        setScreenFrame(frame);
+        return;
+    }
+
+    // Pixel data is stored in 8-row pages of one byte per column
+    const auto width = frame.size.width();
+    const auto pageCount = frame.size.height() / 8;
+
+    const auto *cur = frame.pixelData.constData();
+    const auto *old = prev.pixelData.constData();
+
+    auto left = width, right = -1, top = pageCount, bottom = -1;
+
+    for(auto page = 0; page < pageCount; ++page) {
+        const auto offset = page * width;
+
+        if(!memcmp(cur + offset, old + offset, width)) {
+            continue;
+        }
+
+        top = qMin(top, page);
+        bottom = page;
+
+        for(auto col = 0; col < left; ++col) {
+            if(cur[offset + col] != old[offset + col]) {
+                left = col;
+                break;
+            }
+        }
+
+        for(auto col = width - 1; col > right; --col) {
+            if(cur[offset + col] != old[offset + col]) {
+                right = col;
+                break;
+            }
+        }
+    }
+
+    if(bottom < 0) {
+        // Identical frame, nothing to repaint
+        return;
+    }
+
+    auto changed = frame;
+    changed.dirtyRect = QRect(left, top * 8, right - left + 1, (bottom - top + 1) * 8);
+
+    m_screenData = changed;
+    emit screenFrameChanged();
+
+    if(m_isLatencyProbePending) {
+        probeInputLatency();
+    }
+}
+
+void ScreenStreamer::probeInputLatency()
+{
+    // The frame could have changed back to the state seen at input time
+    if(qHash(m_screenData.pixelData) == m_probeFrameHash) {
+        return;
+    }
+
+    const auto latency = (int)m_probeTimer.elapsed();
+    m_isLatencyProbePending = false;
+
+    if(m_latencySamples.size() < MAX_LATENCY_SAMPLES) {
+        m_latencySamples.append(latency);
+    } else {
+        m_latencySamples[m_latencySampleIndex] = latency;
+        m_latencySampleIndex = (m_latencySampleIndex + 1) % MAX_LATENCY_SAMPLES;
+    }
+
+    qCDebug(CATEGORY_SCREEN).noquote() << "Input latency:" << latency << "ms, p50:" << inputLatencyP50() << "ms, p99:" << inputLatencyP99() << "ms";
+
+    emit inputLatencyChanged();
+}
+
+int ScreenStreamer::inputLatencyPercentile(double percentile) const
+{
+    if(m_latencySamples.isEmpty()) {
+        return -1;
+    }
+
+    auto samples = m_latencySamples;
+    const auto n = qMin((int)(percentile * samples.size()), samples.size() - 1);
+
+    std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+    return samples.at(n);
+}
@@ -1,12 +1,18 @@
 #pragma once
 
 #include <QSize>
+#include <QPair>
+#include <QVector>
 #include <QObject>
+#include <QPointer>
 #include <QByteArray>
+#include <QElapsedTimer>
 
 #include "inputevent.h"
 #include "screenframe.h"
 
+class AbstractOperation;
+
 namespace Flipper {
 
 class SerialDevice;
@@ -19,6 +25,9 @@ class ScreenStreamer : public QObject
     Q_PROPERTY(ScreenFrame screenFrame READ screenFrame NOTIFY screenFrameChanged)
     Q_PROPERTY(bool isEnabled READ isEnabled WRITE setEnabled NOTIFY streamStateChanged)
     Q_PROPERTY(bool isPaused READ isPaused WRITE setPaused NOTIFY streamStateChanged)
+    Q_PROPERTY(bool isLatencyProbeEnabled READ isLatencyProbeEnabled WRITE setLatencyProbeEnabled NOTIFY inputLatencyChanged)
+    Q_PROPERTY(int inputLatencyP50 READ inputLatencyP50 NOTIFY inputLatencyChanged)
+    Q_PROPERTY(int inputLatencyP99 READ inputLatencyP99 NOTIFY inputLatencyChanged)
 
 public:
     enum StreamState {
@@ -46,9 +55,18 @@ public:
 
     const ScreenFrame &screenFrame() const;
 
+    // Instrumentation: measure the time from an input event to the next changed frame
+    bool isLatencyProbeEnabled() const;
+    void setLatencyProbeEnabled(bool set);
+
+    // Input-to-frame latency percentiles in milliseconds, -1 if not measured yet
+    int inputLatencyP50() const;
+    int inputLatencyP99() const;
+
 signals:
     void streamStateChanged();
     void screenFrameChanged();
+    void inputLatencyChanged();
 
 public slots:
     void start();
@@ -61,10 +79,26 @@ private slots:
 private:
     void setStreamState(StreamState newState);
     void setScreenFrame(const ScreenFrame &frame);
+    void updateScreenFrame(const ScreenFrame &frame);
+    void sendPendingInputEvents();
+    void resetPendingInput();
+    void probeInputLatency();
+    int inputLatencyPercentile(double percentile) const;
 
     StreamState m_streamState;
     ScreenFrame m_screenData;
     SerialDevice *m_device;
+
+    QVector<QPair<int, int>> m_pendingInputEvents;
+    // Cleared on completion, as well as when the operation is dropped from the queue unfinished
+    QPointer<AbstractOperation> m_inputOperation;
+
+    bool m_isLatencyProbeEnabled;
+    bool m_isLatencyProbePending;
+    size_t m_probeFrameHash;
+    QElapsedTimer m_probeTimer;
+    QVector<int> m_latencySamples;
+    int m_latencySampleIndex;
 };
 
 }
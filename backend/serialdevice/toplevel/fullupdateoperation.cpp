@@ -16,9 +16,14 @@
 #include "tarzipuncompressor.h"
 #include "tempdirectories.h"
 #include "remotefilefetcher.h"
+#include "artifactstore.h"
+#include "resourcescheduler.h"
 
 #define REMOTE_DIR "/ext/update"
 
+// Maximum number of extracted files waiting to be verified and uploaded
+#define PIPELINE_QUEUE_SIZE 8
+
 Q_DECLARE_LOGGING_CATEGORY(CATEGORY_DEBUG)
 
 static inline const QString getBaseName(const QString &url)
@@ -34,6 +39,12 @@ using namespace Zero;
 FullUpdateOperation::FullUpdateOperation(UtilityInterface *utility, DeviceState *state, const Updates::VersionInfo &versionInfo, QObject *parent):
     AbstractTopLevelOperation(state, parent),
     m_updateFile(nullptr),
+    m_uncompressor(nullptr),
+    m_processedFileCount(0),
+    m_isExtractionFinished(false),
+    m_isUploadBusy(false),
+    m_isRemotePathCreated(false),
+    m_isRemotePathExisting(false),
     m_utility(utility),
     m_versionInfo(versionInfo)
 {}
@@ -41,11 +52,35 @@ FullUpdateOperation::FullUpdateOperation(UtilityInterface *utility, DeviceState
 FullUpdateOperation::FullUpdateOperation(UtilityInterface *utility, DeviceState *deviceState, const QUrl &bundleUrl, QObject *parent):
     AbstractTopLevelOperation(deviceState, parent),
     m_updateFile(new QFile(bundleUrl.toLocalFile(), this)),
+    m_uncompressor(nullptr),
+    m_processedFileCount(0),
+    m_isExtractionFinished(false),
+    m_isUploadBusy(false),
+    m_isRemotePathCreated(false),
+    m_isRemotePathExisting(false),
     m_utility(utility)
 {}
 
 FullUpdateOperation::~FullUpdateOperation()
 {
+    if(m_uncompressor && !m_isExtractionFinished) {
+        // Let the worker threads wind down before the uncompressor is destroyed,
+        // the input file must stay alive for as long as they may read it
+        m_uncompressor->abort();
+        m_uncompressor->setParent(nullptr);
+        m_updateFile->setParent(m_uncompressor);
+
+        const auto checksum = m_updateChecksum;
+
+        connect(m_uncompressor, &TarZipUncompressor::finished, m_uncompressor, [=]() {
+            if(!checksum.isEmpty()) {
+                globalArtifactStore->endExtraction(checksum, false);
+            }
+        });
+
+        connect(m_uncompressor, &TarZipUncompressor::finished, m_uncompressor, &QObject::deleteLater);
+    }
+
     deviceState()->setAllowVirtualDisplay(true);
 }
 
@@ -143,8 +178,48 @@ void FullUpdateOperation::fetchUpdateFile()
         return;
     }
 
-    m_updateFile = globalTempDirs->createTempFile(this);
-    m_updateDirectory = globalTempDirs->subdir(getBaseName(fileInfo.url()));
+    m_updateChecksum = fileInfo.sha256();
+
+    const auto extractPath = globalArtifactStore->extractPath(m_updateChecksum);
+    m_updateDirectory = extractPath.isEmpty() ? globalTempDirs->subdir(getBaseName(fileInfo.url())) : QDir(extractPath);
+
+    if(globalArtifactStore->isExtracted(m_updateChecksum)) {
+        qCDebug(CATEGORY_DEBUG) << "Update package has been already extracted, skipping to reading...";
+        setOperationState(ExtractingUpdate);
+        advanceOperationState();
+        return;
+    }
+
+    m_updateFile = globalArtifactStore->file(m_updateChecksum, this);
+
+    if(m_updateFile) {
+        qCDebug(CATEGORY_DEBUG) << "Update package has been already downloaded, skipping to extraction...";
+        advanceOperationState();
+        return;
+    }
+
+    globalResourceScheduler->acquire(ResourceScheduler::Resource::Network, this, [=]() {
+        downloadUpdateFile(fileInfo);
+    });
+}
+
+void FullUpdateOperation::downloadUpdateFile(const Updates::FileInfo &fileInfo)
+{
+    // Another device might have fetched the same package while this one was waiting
+    m_updateFile = globalArtifactStore->file(m_updateChecksum, this);
+
+    if(m_updateFile) {
+        globalResourceScheduler->release(ResourceScheduler::Resource::Network, this);
+        advanceOperationState();
+        return;
+    }
+
+    // Resumes the download interrupted in an earlier run, if any
+    m_updateFile = globalArtifactStore->partialFile(m_updateChecksum, this);
+
+    if(!m_updateFile) {
+        m_updateFile = globalTempDirs->createTempFile(this);
+    }
 
     auto *fetcher = new RemoteFileFetcher(this);
     if(!fetcher->fetch(fileInfo, m_updateFile)) {
@@ -157,9 +232,23 @@ void FullUpdateOperation::fetchUpdateFile()
     });
 
     connect(fetcher, &RemoteFileFetcher::finished, this, [=]() {
+        globalResourceScheduler->release(ResourceScheduler::Resource::Network, this);
+
         if(fetcher->isError()) {
+            // Only a network failure leaves data worth resuming from
+            if(fetcher->error() != BackendError::InternetError) {
+                m_updateFile->remove();
+            }
+
             finishWithError(fetcher->error(), fetcher->errorString());
+
         } else {
+            auto *storedFile = globalArtifactStore->insert(m_updateChecksum, m_updateFile, this);
+
+            if(storedFile) {
+                m_updateFile = storedFile;
+            }
+
             advanceOperationState();
         }
 
@@ -176,22 +265,199 @@ void FullUpdateOperation::prepareLocalUpdate()
 
 void FullUpdateOperation::extractUpdate()
 {
-    deviceState()->setStatusString(QStringLiteral("Extracting firmware update ..."));
+    deviceState()->setStatusString(QStringLiteral("Extracting and uploading firmware update ..."));
     deviceState()->setProgress(-1.0);
 
-    auto *uncompressor = new TarZipUncompressor(m_updateFile, m_updateDirectory, this);
-
-    connect(uncompressor, &TarZipUncompressor::finished, this, [=]() {
-        if(uncompressor->isError()) {
-            finishWithError(uncompressor->error(), uncompressor->errorString());
-        } else {
+    globalResourceScheduler->acquire(ResourceScheduler::Resource::Extraction, this, [=]() {
+        if(!m_updateChecksum.isEmpty() && globalArtifactStore->isExtracted(m_updateChecksum)) {
+            qCDebug(CATEGORY_DEBUG) << "Update package has been extracted in the meantime, skipping to reading...";
+            globalResourceScheduler->release(ResourceScheduler::Resource::Extraction, this);
             advanceOperationState();
+            return;
+
+        } else if(!m_updateChecksum.isEmpty() && !globalArtifactStore->beginExtraction(m_updateChecksum)) {
+            // Another device is extracting the same package into the shared directory
+            m_updateDirectory = globalTempDirs->subdir(QStringLiteral("%1-%2").arg(m_updateDirectory.dirName()).arg((quintptr)this, 0, 16));
+            m_updateChecksum.clear();
         }
 
-        uncompressor->deleteLater();
+        // Each extracted file is verified and uploaded while the rest of the archive is still being extracted.
+        // The number of files waiting for upload is bounded, so a slow serial link throttles the extraction.
+        m_uncompressor = new TarZipUncompressor(m_updateFile, m_updateDirectory, m_updateChecksum, this);
+        m_uncompressor->setMaxPendingFiles(PIPELINE_QUEUE_SIZE);
+
+        connect(m_uncompressor, &TarZipUncompressor::fileExtracted, this, &FullUpdateOperation::onUpdateFileExtracted, Qt::QueuedConnection);
+        connect(m_uncompressor, &TarZipUncompressor::finished, this, &FullUpdateOperation::onUpdateExtracted);
     });
 }
 
+void FullUpdateOperation::onUpdateFileExtracted(const QString &filePath)
+{
+    if(operationState() != ExtractingUpdate) {
+        return;
+    }
+
+    // Only the files located directly in the top-level update directory are uploaded
+    const auto sepIdx = filePath.indexOf('/');
+    const auto isUpdateFile = (sepIdx > 0) && (filePath.indexOf('/', sepIdx + 1) < 0);
+
+    if(isUpdateFile && m_updateDirName.isEmpty()) {
+        m_updateDirName = filePath.left(sepIdx);
+    }
+
+    if(!isUpdateFile || filePath.left(sepIdx) != m_updateDirName) {
+        releaseExtractedFiles(1);
+        return;
+    }
+
+    m_pendingUrls.append(QUrl::fromLocalFile(m_updateDirectory.absoluteFilePath(filePath)));
+    processUploadQueue();
+}
+
+void FullUpdateOperation::onUpdateExtracted()
+{
+    m_isExtractionFinished = true;
+    globalResourceScheduler->release(ResourceScheduler::Resource::Extraction, this);
+
+    if(!m_updateChecksum.isEmpty()) {
+        globalArtifactStore->endExtraction(m_updateChecksum, !m_uncompressor->isError() && !m_updateDirName.isEmpty());
+    }
+
+    if(operationState() != ExtractingUpdate) {
+        return;
+
+    } else if(m_uncompressor->isError()) {
+        finishWithError(m_uncompressor->error(), m_uncompressor->errorString());
+        return;
+
+    } else if(m_updateDirName.isEmpty()) {
+        finishWithError(BackendError::DataError, QStringLiteral("Cannot find update directory"));
+        return;
+    }
+
+    qCDebug(CATEGORY_DEBUG).noquote() << "Update extracted at" << m_uncompressor->throughput() / 1024.0 << "KiB/s";
+
+    processUploadQueue();
+}
+
+void FullUpdateOperation::processUploadQueue()
+{
+    if(m_isUploadBusy) {
+        return;
+
+    } else if(!m_pendingUrls.isEmpty()) {
+        const auto fileUrls = m_pendingUrls;
+        m_pendingUrls.clear();
+        verifyAndUploadBatch(fileUrls);
+
+    } else if(m_isExtractionFinished) {
+        if(!m_updateDirectory.cd(m_updateDirName)) {
+            finishWithError(BackendError::DataError, QStringLiteral("Cannot enter update directory"));
+            return;
+        }
+
+        m_uncompressor->deleteLater();
+        m_uncompressor = nullptr;
+
+        setOperationState(UploadingUpdateFiles);
+        advanceOperationState();
+    }
+}
+
+void FullUpdateOperation::verifyAndUploadBatch(const QList<QUrl> &fileUrls)
+{
+    if(operationState() != ExtractingUpdate) {
+        return;
+    }
+
+    m_isUploadBusy = true;
+
+    const auto remotePath = QStringLiteral("%1/%2").arg(REMOTE_DIR, m_updateDirName).toLocal8Bit();
+
+    if(!m_isRemotePathCreated) {
+        auto *operation = m_utility->createPath(remotePath);
+
+        connect(operation, &AbstractOperation::finished, this, [=]() {
+            if(operation->isError()) {
+                finishPipelineWithError(operation->error(), operation->errorString());
+            } else {
+                m_isRemotePathCreated = true;
+                m_isRemotePathExisting = operation->pathExists();
+                verifyAndUploadBatch(fileUrls);
+            }
+        });
+
+        return;
+    }
+
+    const auto uploadFiles = [=](const QList<QUrl> &changedUrls) {
+        if(changedUrls.isEmpty()) {
+            onBatchUploaded(fileUrls.size());
+            return;
+        }
+
+        auto *operation = m_utility->uploadFiles(changedUrls, remotePath);
+
+        connect(operation, &AbstractOperation::finished, this, [=]() {
+            if(operation->isError()) {
+                finishPipelineWithError(operation->error(), operation->errorString());
+            } else {
+                onBatchUploaded(fileUrls.size());
+            }
+        });
+    };
+
+    // A freshly created directory cannot contain any of the files
+    if(!m_isRemotePathExisting) {
+        uploadFiles(fileUrls);
+        return;
+    }
+
+    auto *operation = m_utility->verifyChecksum(fileUrls, remotePath);
+
+    connect(operation, &AbstractOperation::finished, this, [=]() {
+        if(operation->isError()) {
+            finishPipelineWithError(operation->error(), operation->errorString());
+        } else {
+            uploadFiles(operation->changedUrls());
+        }
+    });
+}
+
+void FullUpdateOperation::onBatchUploaded(int fileCount)
+{
+    if(operationState() != ExtractingUpdate) {
+        return;
+    }
+
+    m_isUploadBusy = false;
+
+    releaseExtractedFiles(fileCount);
+    processUploadQueue();
+}
+
+void FullUpdateOperation::releaseExtractedFiles(int fileCount)
+{
+    m_processedFileCount += fileCount;
+    m_uncompressor->releaseFiles(fileCount);
+
+    const auto totalFileCount = m_uncompressor->fileCount();
+    if(totalFileCount > 0) {
+        deviceState()->setProgress(m_processedFileCount * 100.0 / totalFileCount);
+    }
+}
+
+void FullUpdateOperation::finishPipelineWithError(BackendError::ErrorType error, const QString &errorString)
+{
+    if(operationState() != ExtractingUpdate) {
+        return;
+    } else if(m_uncompressor) {
+        m_uncompressor->abort();
+    }
+
+    finishWithError(error, errorString);
+}
+
 void FullUpdateOperation::readUpdateFiles()
 {
     deviceState()->setStatusString(QStringLiteral("Reading firmware update ..."));
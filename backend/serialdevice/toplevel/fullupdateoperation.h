@@ -9,6 +9,7 @@
 #include "flipperupdates.h"
 
 class QFile;
+class TarZipUncompressor;
 
 namespace Flipper {
 namespace Zero {
@@ -40,13 +41,21 @@ public:
 
 private slots:
     void nextStateLogic() override;
+    void onUpdateFileExtracted(const QString &filePath);
+    void onUpdateExtracted();
 
 private:
     void provisionRegionData();
     void checkStorage();
     void fetchUpdateFile();
+    void downloadUpdateFile(const Updates::FileInfo &fileInfo);
     void prepareLocalUpdate();
     void extractUpdate();
+    void processUploadQueue();
+    void verifyAndUploadBatch(const QList<QUrl> &fileUrls);
+    void onBatchUploaded(int fileCount);
+    void releaseExtractedFiles(int fileCount);
+    void finishPipelineWithError(BackendError::ErrorType error, const QString &errorString);
     void readUpdateFiles();
     void createUpdatePath();
     void verifyExistingFiles();
@@ -54,8 +63,19 @@ private:
     void startUpdate();
 
     QFile *m_updateFile;
+    QByteArray m_updateChecksum;
     QDir m_updateDirectory;
     QList<QUrl> m_fileUrls;
+
+    TarZipUncompressor *m_uncompressor;
+    QString m_updateDirName;
+    QList<QUrl> m_pendingUrls;
+    int m_processedFileCount;
+    bool m_isExtractionFinished;
+    bool m_isUploadBusy;
+    bool m_isRemotePathCreated;
+    bool m_isRemotePathExisting;
+
     UtilityInterface *m_utility;
     Updates::VersionInfo m_versionInfo;
 };
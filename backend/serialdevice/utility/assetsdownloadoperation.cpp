@@ -18,6 +18,7 @@
 #include "serialdevice/devicestate.h"
 
 #include "gzipuncompressor.h"
+#include "seekablegzipfile.h"
 #include "tempdirectories.h"
 #include "tararchive.h"
 
@@ -114,6 +115,21 @@ void AssetsDownloadOperation::checkForExtStorage()
 
 void AssetsDownloadOperation::extractArchive()
 {
+    auto *compressedFile = qobject_cast<QFileDevice*>(m_compressedFile);
+
+    if(compressedFile && SeekableGZipFile::isSeekable(compressedFile->fileName())) {
+        qCDebug(CATEGORY_ASSETS) << "Blocked gzip archive detected, reading in place";
+        m_archive = new TarArchive(new SeekableGZipFile(compressedFile->fileName(), this), this);
+
+        if(m_archive->isError()) {
+            finishWithError(m_archive->error(), m_archive->errorString());
+        } else {
+            advanceOperationState();
+        }
+
+        return;
+    }
+
     auto *uncompressor = new GZipUncompressor(m_compressedFile, m_uncompressedFile, this);
 
     if(uncompressor->isError()) {
@@ -13,13 +13,20 @@
 
 Q_LOGGING_CATEGORY(LOG_VIRTDISPLAY, "DPY")
 
+#define FPS_WINDOW_MS 1000
+
 using namespace Flipper;
 using namespace Zero;
 
 VirtualDisplay::VirtualDisplay(QObject *parent):
     QObject(parent),
     m_displayState(DisplayState::Stopped),
-    m_device(nullptr)
+    m_device(nullptr),
+    m_hasPendingFrame(false),
+    m_fpsFrameCount(0),
+    m_framesPerSecond(0),
+    m_sentFrameCount(0),
+    m_droppedFrameCount(0)
 {}
 
 void VirtualDisplay::setDevice(SerialDevice *device)
@@ -40,6 +47,21 @@ VirtualDisplay::DisplayState VirtualDisplay::displayState() const
     return m_displayState;
 }
 
+double VirtualDisplay::framesPerSecond() const
+{
+    return m_framesPerSecond;
+}
+
+int VirtualDisplay::sentFrameCount() const
+{
+    return m_sentFrameCount;
+}
+
+int VirtualDisplay::droppedFrameCount() const
+{
+    return m_droppedFrameCount;
+}
+
 void VirtualDisplay::start(const QByteArray &firstFrame)
 {
     if(m_displayState != DisplayState::Stopped) {
@@ -47,6 +69,8 @@ void VirtualDisplay::start(const QByteArray &firstFrame)
     }
 
     setDisplayState(DisplayState::Starting);
+    resetMailbox();
+    resetStatistics();
 
     auto *operation = m_device->rpc()->guiStartVirtualDisplay(firstFrame);
     connect(operation, &AbstractOperation::finished, this, [=]() {
@@ -61,13 +85,17 @@ void VirtualDisplay::start(const QByteArray &firstFrame)
 
 void VirtualDisplay::sendFrame(const QByteArray &screenFrame)
 {
-    auto *operation = m_device->rpc()->guiSendScreenFrame(screenFrame);
+    if(m_hasPendingFrame) {
+        ++m_droppedFrameCount;
+        emit statisticsChanged();
+    }
 
-    connect(operation, &AbstractOperation::finished, this, [=]() {
-        if(operation->isError()) {
-            qCDebug(LOG_VIRTDISPLAY).noquote() << "Failed to send screen frame:" << operation->errorString();
-        }
-    });
+    m_pendingFrame = screenFrame;
+    m_hasPendingFrame = true;
+
+    if(!m_frameOperation) {
+        sendPendingFrame();
+    }
 }
 
 void VirtualDisplay::stop()
@@ -77,6 +105,7 @@ void VirtualDisplay::stop()
     }
 
     setDisplayState(DisplayState::Stopping);
+    resetMailbox();
 
     auto *operation = m_device->rpc()->guiStopVirtualDisplay();
 
@@ -93,7 +122,83 @@ void VirtualDisplay::onProtobufSessionStateChanged()
 {
     if(!m_device->rpc()->isSessionUp()) {
         setDisplayState(Stopped);
+        // Operations still queued are dropped without finishing
+        resetMailbox();
+    }
+}
+
+void VirtualDisplay::sendPendingFrame()
+{
+    m_hasPendingFrame = false;
+
+    auto *operation = m_device->rpc()->guiSendScreenFrame(m_pendingFrame);
+    m_frameOperation = operation;
+    m_pendingFrame.clear();
+
+    // Dropped from the queue without finishing, pass the slot on to the newest frame
+    connect(operation, &QObject::destroyed, this, [=]() {
+        if(!m_frameOperation && m_hasPendingFrame && m_displayState == DisplayState::Running) {
+            sendPendingFrame();
+        }
+    });
+
+    connect(operation, &AbstractOperation::finished, this, [=]() {
+        // The mailbox has been reset in the meantime
+        if(m_frameOperation != operation) {
+            return;
+        }
+
+        if(operation->isError()) {
+            qCDebug(LOG_VIRTDISPLAY).noquote() << "Failed to send screen frame:" << operation->errorString();
+        } else {
+            onFrameSent();
+        }
+
+        m_frameOperation.clear();
+
+        if(m_hasPendingFrame) {
+            sendPendingFrame();
+        }
+    });
+}
+
+void VirtualDisplay::resetMailbox()
+{
+    m_pendingFrame.clear();
+    m_hasPendingFrame = false;
+    m_frameOperation.clear();
+}
+
+void VirtualDisplay::onFrameSent()
+{
+    ++m_sentFrameCount;
+
+    // The first delivered frame only opens the measurement window
+    if(!m_fpsTimer.isValid()) {
+        m_fpsTimer.start();
+        emit statisticsChanged();
+        return;
     }
+
+    ++m_fpsFrameCount;
+
+    if(m_fpsTimer.elapsed() >= FPS_WINDOW_MS) {
+        m_framesPerSecond = m_fpsFrameCount * 1000.0 / m_fpsTimer.restart();
+        m_fpsFrameCount = 0;
+    }
+
+    emit statisticsChanged();
+}
+
+void VirtualDisplay::resetStatistics()
+{
+    m_fpsTimer.invalidate();
+    m_fpsFrameCount = 0;
+    m_framesPerSecond = 0;
+    m_sentFrameCount = 0;
+    m_droppedFrameCount = 0;
+
+    emit statisticsChanged();
 }
 
 void VirtualDisplay::setDisplayState(DisplayState newState)
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <QObject>
+#include <QPointer>
 #include <QByteArray>
+#include <QElapsedTimer>
+
+class AbstractOperation;
 
 namespace Flipper {
 class SerialDevice;
@@ -11,6 +15,9 @@ namespace Zero {
 class VirtualDisplay : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(double framesPerSecond READ framesPerSecond NOTIFY statisticsChanged)
+    Q_PROPERTY(int sentFrameCount READ sentFrameCount NOTIFY statisticsChanged)
+    Q_PROPERTY(int droppedFrameCount READ droppedFrameCount NOTIFY statisticsChanged)
 
 public:
     enum DisplayState {
@@ -27,8 +34,15 @@ public:
 
     DisplayState displayState() const;
 
+    // Frames actually delivered per second, measured over the last second
+    double framesPerSecond() const;
+    int sentFrameCount() const;
+    // Frames replaced by a newer one before they could be sent
+    int droppedFrameCount() const;
+
 signals:
     void displayStateChanged();
+    void statisticsChanged();
 
 public slots:
     void start(const QByteArray &firstFrame = QByteArray());
@@ -40,9 +54,25 @@ private slots:
 
 private:
     void setDisplayState(DisplayState newState);
+    void sendPendingFrame();
+    void resetMailbox();
+    void onFrameSent();
+    void resetStatistics();
 
     DisplayState m_displayState;
     SerialDevice *m_device;
+
+    // Single-slot mailbox: at most one frame in flight, the newest one waiting.
+    // The in-flight slot is also released if the operation is dropped from the queue unfinished.
+    QByteArray m_pendingFrame;
+    bool m_hasPendingFrame;
+    QPointer<AbstractOperation> m_frameOperation;
+
+    QElapsedTimer m_fpsTimer;
+    int m_fpsFrameCount;
+    double m_framesPerSecond;
+    int m_sentFrameCount;
+    int m_droppedFrameCount;
 };
 
 }
@@ -1,22 +1,37 @@
 #include "serialfinder.h"
 
+#include <QDir>
+#include <QFile>
 #include <QTimer>
 #include <QDebug>
+#include <QFileInfo>
 #include <QLoggingCategory>
+#include <QFileSystemWatcher>
 
 Q_DECLARE_LOGGING_CATEGORY(CATEGORY_DEBUG)
 
+#define ENUMERATION_FALLBACK_INTERVAL 10
+
+#ifdef Q_OS_LINUX
+#define DEVICE_DIR "/dev"
+#define SYSFS_TTY_DIR "/sys/class/tty"
+#endif
+
 SerialFinder::SerialFinder(const QString &serialNumber, QObject *parent):
     QObject(parent),
     m_timer(new QTimer(this)),
+    m_watcher(nullptr),
     m_serialNumber(serialNumber),
     m_numTries(100),
-    m_periodMs(15)
+    m_periodMs(15),
+    m_isFinished(false)
 {
     connect(m_timer, &QTimer::timeout, this, &SerialFinder::findMatchingPort);
 
     m_timer->setSingleShot(true);
     m_timer->start(0);
+
+    startWatcher();
 }
 
 void SerialFinder::setNumberOfTries(int numTries)
@@ -32,20 +47,138 @@ void SerialFinder::setTryPeriod(int periodMs)
 void SerialFinder::findMatchingPort()
 {
     if(!(--m_numTries)) {
-        emit finished(QSerialPortInfo());
+        finish(QSerialPortInfo());
+        return;
+    }
+
+    auto portInfo = lookupPort();
+
+    // Safety net in case the sysfs layout is not what we expect
+    if(portInfo.isNull() && m_watcher && !(m_numTries % ENUMERATION_FALLBACK_INTERVAL)) {
+        portInfo = enumeratePorts();
+    }
+
+    if(!portInfo.isNull()) {
+        finish(portInfo);
+        return;
+    }
+
+    m_timer->start(m_periodMs);
+}
+
+void SerialFinder::onDeviceDirectoryChanged()
+{
+    const auto portInfo = lookupPort();
+
+    if(!portInfo.isNull()) {
+        qCDebug(CATEGORY_DEBUG) << "Serial port resolved by the device node watcher";
+        finish(portInfo);
+    }
+}
+
+/* On Linux, react to the tty node appearing (or its permissions being set by udev)
+ * right away instead of waiting for the next polling period. The timer stays on
+ * as a fallback and as the overall timeout. */
+void SerialFinder::startWatcher()
+{
+#ifdef Q_OS_LINUX
+    if(!QFileInfo(QStringLiteral(SYSFS_TTY_DIR)).isDir()) {
+        return;
+    }
+
+    m_watcher = new QFileSystemWatcher(this);
+
+    if(!m_watcher->addPath(QStringLiteral(DEVICE_DIR))) {
+        qCDebug(CATEGORY_DEBUG) << "Failed to watch the device directory, falling back to polling";
+        m_watcher->deleteLater();
+        m_watcher = nullptr;
+        return;
+    }
+
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &SerialFinder::onDeviceDirectoryChanged);
+#endif
+}
+
+void SerialFinder::finish(const QSerialPortInfo &portInfo)
+{
+    if(m_isFinished) {
         return;
     }
 
+    m_isFinished = true;
+    m_timer->stop();
+
+    if(m_watcher) {
+        m_watcher->disconnect(this);
+        m_watcher->deleteLater();
+        m_watcher = nullptr;
+    }
+
+    emit finished(portInfo);
+}
+
+const QSerialPortInfo SerialFinder::lookupPort() const
+{
+#ifdef Q_OS_LINUX
+    // Avoid a full enumeration as long as sysfs can answer the question
+    if(m_watcher) {
+        const auto portName = sysfsPortName();
+
+        if(portName.isEmpty()) {
+            return QSerialPortInfo();
+        }
+
+        const QFileInfo nodeInfo(QDir(QStringLiteral(DEVICE_DIR)).absoluteFilePath(portName));
+
+        // udev may not have applied the permissions yet
+        if(!nodeInfo.exists() || !nodeInfo.isWritable()) {
+            return QSerialPortInfo();
+        }
+
+        return QSerialPortInfo(portName);
+    }
+#endif
+
+    return enumeratePorts();
+}
+
+const QSerialPortInfo SerialFinder::enumeratePorts() const
+{
     const auto portInfos = QSerialPortInfo::availablePorts();
     const auto it = std::find_if(portInfos.cbegin(), portInfos.cend(), [&](const QSerialPortInfo &info) {
         qCDebug(CATEGORY_DEBUG).noquote() << "Trying serial port" << info.serialNumber() << "at" << info.systemLocation();
         return info.serialNumber() == m_serialNumber;
     });
 
-    if(it != portInfos.cend() && !(*it).isNull()) {
-        emit finished(*it);
-        return;
+    return it != portInfos.cend() ? *it : QSerialPortInfo();
+}
+
+#ifdef Q_OS_LINUX
+/* /sys/class/tty/ttyACMx/device points to the USB interface,
+ * the serial number belongs to its parent USB device. */
+const QString SerialFinder::sysfsPortName() const
+{
+    const QDir ttyDir(QStringLiteral(SYSFS_TTY_DIR));
+    const auto portNames = ttyDir.entryList({QStringLiteral("ttyACM*")}, QDir::Dirs | QDir::System | QDir::NoDotAndDotDot);
+
+    for(const auto &portName : portNames) {
+        const auto interfacePath = QFileInfo(ttyDir.absoluteFilePath(portName + QStringLiteral("/device"))).canonicalFilePath();
+
+        if(interfacePath.isEmpty()) {
+            continue;
+        }
+
+        QFile file(QDir::cleanPath(interfacePath + QStringLiteral("/../serial")));
+
+        if(!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        if(QString::fromLatin1(file.readAll()).trimmed() == m_serialNumber) {
+            return portName;
+        }
     }
 
-    m_timer->start(m_periodMs);
+    return QString();
 }
+#endif
@@ -5,6 +5,7 @@
 #include <QSerialPortInfo>
 
 class QTimer;
+class QFileSystemWatcher;
 
 class SerialFinder : public QObject
 {
@@ -21,13 +22,26 @@ signals:
 
 private slots:
     void findMatchingPort();
+    void onDeviceDirectoryChanged();
 
 private:
+    void startWatcher();
+    void finish(const QSerialPortInfo &portInfo);
+
+    const QSerialPortInfo lookupPort() const;
+    const QSerialPortInfo enumeratePorts() const;
+
+#ifdef Q_OS_LINUX
+    const QString sysfsPortName() const;
+#endif
+
     QTimer *m_timer;
+    QFileSystemWatcher *m_watcher;
     QString m_serialNumber;
 
     int m_numTries;
     int m_periodMs;
+    bool m_isFinished;
 };
 
 #endif // SERIALFINDER_H
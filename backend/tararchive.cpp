@@ -1,18 +1,30 @@
 #include "tararchive.h"
 
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QDirIterator>
 
 #include <QIODevice>
 #include <QDateTime>
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <QLoggingCategory>
 
 #include <QFutureWatcher>
 #include <QtConcurrent/QtConcurrentRun>
 
+#include "artifactstore.h"
+
+Q_LOGGING_CATEGORY(LOG_TAR, "TAR")
+
 #define BLOCK_SIZE 512
 #define CHUNK_SIZE (4 * 1024 * 1024)
 
+#define INDEX_MAGIC 0x58444954 // "TIDX"
+#define INDEX_VERSION 1
+#define INDEX_SUFFIX QByteArrayLiteral(".idx")
+
 struct TarHeader
 {
     char name[100];
@@ -29,6 +41,40 @@ struct TarHeader
 
 static_assert(sizeof(TarHeader) == BLOCK_SIZE, "Check TarHeader alignment");
 
+// Index sidecar layout: IndexHeader, then entryCount times IndexEntry followed by nameSize bytes of UTF-8 path.
+// Entries are stored in pre-order so that every parent directory precedes its children.
+struct IndexHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 entryCount;
+    quint32 reserved;
+    qint64 archiveSize;
+};
+
+struct IndexEntry
+{
+    qint64 offset;
+    qint64 size;
+    quint16 nameSize;
+    quint8 type;
+    quint8 reserved[5];
+};
+
+static_assert(sizeof(IndexHeader) == 24, "Check IndexHeader alignment");
+static_assert(sizeof(IndexEntry) == 24, "Check IndexEntry alignment");
+
+static const QString indexFilePath(const QByteArray &checksum)
+{
+    // Indices are kept in the artifact store, so they are evicted like any other artifact.
+    // Looking an existing one up marks it as recently used.
+    const auto indexChecksum = checksum + INDEX_SUFFIX;
+    QScopedPointer<QFile> indexFile(globalArtifactStore->file(indexChecksum));
+
+    return indexFile ? indexFile->fileName() :
+                       globalArtifactStore->root().absoluteFilePath(QString::fromLatin1(indexChecksum.toLower()));
+}
+
 static bool isMemZeros(char *p, size_t len)
 {
     while(len--) {
@@ -68,6 +114,35 @@ TarArchive::TarArchive(QIODevice *inputFile, QObject *parent):
     }
 }
 
+TarArchive::TarArchive(QIODevice *inputFile, const QByteArray &checksum, QObject *parent):
+    QObject(parent),
+    m_tarFile(inputFile),
+    m_root(new FileNode("", FileNode::Type::Directory))
+{
+    if(!m_tarFile->open(QIODevice::ReadOnly)) {
+        setError(BackendError::DiskError, m_tarFile->errorString());
+        return;
+    }
+
+    const auto fileName = checksum.isEmpty() ? QString() : indexFilePath(checksum);
+
+    if(fileName.isEmpty()) {
+        readTarFile();
+
+    } else if(readIndexFile(fileName)) {
+        qCDebug(LOG_TAR).noquote() << "Loaded archive index from" << fileName;
+
+    } else {
+        // Discard whatever might have been loaded from a stale index
+        m_root.reset(new FileNode("", FileNode::Type::Directory));
+        readTarFile();
+
+        if(!isError()) {
+            writeIndexFile(fileName);
+        }
+    }
+}
+
 TarArchive::TarArchive(const QDir &inputDir, QIODevice *outputFile, QObject *parent):
     QObject(parent),
     m_tarFile(outputFile),
@@ -182,6 +257,124 @@ void TarArchive::readTarFile()
     } while(m_tarFile->bytesAvailable());
 }
 
+bool TarArchive::readIndexFile(const QString &fileName)
+{
+    QFile indexFile(fileName);
+
+    if(!indexFile.exists() || !indexFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const auto indexSize = indexFile.size();
+
+    if(indexSize < (qint64)sizeof(IndexHeader)) {
+        return false;
+    }
+
+    const auto *data = (const char*)indexFile.map(0, indexSize);
+
+    if(!data) {
+        return false;
+    }
+
+    IndexHeader header;
+    memcpy(&header, data, sizeof(IndexHeader));
+
+    if((header.magic != INDEX_MAGIC) || (header.version != INDEX_VERSION) || (header.archiveSize != m_tarFile->size())) {
+        return false;
+    }
+
+    qint64 pos = sizeof(IndexHeader);
+
+    for(quint32 i = 0; i < header.entryCount; ++i) {
+        IndexEntry entry;
+
+        if(pos + (qint64)sizeof(IndexEntry) > indexSize) {
+            return false;
+        }
+
+        memcpy(&entry, data + pos, sizeof(IndexEntry));
+        pos += sizeof(IndexEntry);
+
+        if(pos + entry.nameSize > indexSize) {
+            return false;
+        }
+
+        const auto name = QString::fromUtf8(data + pos, entry.nameSize);
+        pos += entry.nameSize;
+
+        bool success;
+
+        if(entry.type == (quint8)FileNode::Type::RegularFile) {
+            FileInfo info;
+
+            info.offset = entry.offset;
+            info.size = entry.size;
+
+            success = m_root->addFile(name, QVariant::fromValue(info));
+
+        } else if(entry.type == (quint8)FileNode::Type::Directory) {
+            success = m_root->addDirectory(name);
+
+        } else {
+            success = false;
+        }
+
+        if(!success) {
+            return false;
+        }
+    }
+
+    return pos == indexSize;
+}
+
+void TarArchive::writeIndexFile(const QString &fileName)
+{
+    const auto fileInfos = m_root->toPreOrderList();
+
+    QByteArray buf;
+    buf.reserve(sizeof(IndexHeader) + fileInfos.size() * (sizeof(IndexEntry) + 32));
+
+    IndexHeader header = {};
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.archiveSize = m_tarFile->size();
+
+    buf.append((const char*)&header, sizeof(IndexHeader));
+
+    for(const auto &fileInfo : fileInfos) {
+        // Skip the root node
+        if(fileInfo.absolutePath.isEmpty()) {
+            continue;
+        }
+
+        const auto name = fileInfo.absolutePath.toUtf8();
+
+        IndexEntry entry = {};
+        entry.nameSize = name.size();
+        entry.type = (quint8)fileInfo.type;
+
+        if(fileInfo.type == FileNode::Type::RegularFile) {
+            const auto data = fileInfo.userData.value<FileInfo>();
+            entry.offset = data.offset;
+            entry.size = data.size;
+        }
+
+        buf.append((const char*)&entry, sizeof(IndexEntry));
+        buf.append(name);
+
+        ++header.entryCount;
+    }
+
+    memcpy(buf.data(), &header, sizeof(IndexHeader));
+
+    QSaveFile indexFile(fileName);
+
+    if(!indexFile.open(QIODevice::WriteOnly) || (indexFile.write(buf) != buf.size()) || !indexFile.commit()) {
+        qCWarning(LOG_TAR).noquote() << "Failed to write archive index:" << indexFile.errorString();
+    }
+}
+
 void TarArchive::assembleTarFile(const QDir &inputDir)
 {
     TarHeader header = {};
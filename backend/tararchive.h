@@ -23,6 +23,7 @@ public:
     };
 
     TarArchive(QIODevice *inputFile, QObject *parent = nullptr);
+    TarArchive(QIODevice *inputFile, const QByteArray &checksum, QObject *parent = nullptr);
     TarArchive(const QDir &inputDir, QIODevice *outputFile, QObject *parent = nullptr);
 
     FileNode *root() const;
@@ -34,6 +35,8 @@ signals:
 
 private:
     void readTarFile();
+    bool readIndexFile(const QString &fileName);
+    void writeIndexFile(const QString &fileName);
     void assembleTarFile(const QDir &inputDir);
 
     QIODevice *m_tarFile;
@@ -2,21 +2,62 @@
 
 #include <QDir>
 #include <QFile>
+#include <QTimer>
 
 #include "tararchive.h"
 #include "gzipcompressor.h"
 #include "gzipuncompressor.h"
+#include "seekablegzipfile.h"
 #include "tempdirectories.h"
+#include "artifactstore.h"
+
+#define STORED_TAR_SUFFIX QByteArrayLiteral(".tar")
 
 TarZipArchive::TarZipArchive(QFile *inputFile, QObject *parent):
+    TarZipArchive(inputFile, QByteArray(), parent)
+{}
+
+TarZipArchive::TarZipArchive(QFile *inputFile, const QByteArray &checksum, QObject *parent):
+    TarZipArchive(inputFile, checksum, false, parent)
+{}
+
+TarZipArchive::TarZipArchive(QFile *inputFile, const QByteArray &checksum, bool isTarCached, QObject *parent):
     QObject(parent),
+    m_tarFile(nullptr),
+    m_isTarStored(false),
     m_tarArchive(nullptr)
 {
-    const QFileInfo tzFileInfo(*inputFile);
-    const auto tzFileDir = tzFileInfo.absoluteDir();
-    const auto fileName = tzFileInfo.baseName() + QStringLiteral(".tar");
+    if(SeekableGZipFile::isSeekable(inputFile->fileName())) {
+        // Blocked gzip: read the members in place, inflating only the blocks that are accessed
+        m_seekableFileName = inputFile->fileName();
+        m_tarArchive = new TarArchive(new SeekableGZipFile(m_seekableFileName, this), checksum, this);
+
+        if(m_tarArchive->isError()) {
+            setError(m_tarArchive->error(), QStringLiteral("Failed to build archive index: %1").arg(m_tarArchive->errorString()));
+        }
+
+        QTimer::singleShot(0, this, &TarZipArchive::ready);
+        return;
+    }
+
+    const auto tarChecksum = (isTarCached && !checksum.isEmpty()) ? checksum + STORED_TAR_SUFFIX : QByteArray();
 
-    m_tarFile = new QFile(tzFileDir.absoluteFilePath(fileName), this);
+    if(!tarChecksum.isEmpty() && (m_tarFile = globalArtifactStore->file(tarChecksum, this))) {
+        m_isTarStored = true;
+        m_tarArchive = new TarArchive(m_tarFile, checksum, this);
+
+        if(m_tarArchive->isError()) {
+            setError(m_tarArchive->error(), QStringLiteral("Failed to build archive index: %1").arg(m_tarArchive->errorString()));
+            // Damaged, let the next attempt inflate the archive again
+            m_tarFile->remove();
+        }
+
+        QTimer::singleShot(0, this, &TarZipArchive::ready);
+        return;
+    }
+
+    // Keep the intermediate file out of the input directory, which might be the artifact store
+    m_tarFile = globalTempDirs->createTempFile(this);
 
     auto *uncompressor = new GZipUncompressor(inputFile, m_tarFile, this);
 
@@ -30,7 +71,16 @@ TarZipArchive::TarZipArchive(QFile *inputFile, QObject *parent):
             setError(uncompressor->error(), QStringLiteral("Failed to uncompress *tar.gz file: %1").arg(uncompressor->errorString()));
 
         } else {
-            m_tarArchive = new TarArchive(m_tarFile, this);
+            if(!tarChecksum.isEmpty()) {
+                auto *storedFile = globalArtifactStore->insert(tarChecksum, m_tarFile, this);
+
+                if(storedFile) {
+                    m_tarFile = storedFile;
+                    m_isTarStored = true;
+                }
+            }
+
+            m_tarArchive = new TarArchive(m_tarFile, checksum, this);
 
             if(m_tarArchive->isError()) {
                 setError(m_tarArchive->error(), QStringLiteral("Failed to build archive index: %1").arg(m_tarArchive->errorString()));
@@ -44,6 +94,7 @@ TarZipArchive::TarZipArchive(QFile *inputFile, QObject *parent):
 TarZipArchive::TarZipArchive(const QDir &inputDir, QFile *outputFile, QObject *parent):
     QObject(parent),
     m_tarFile(globalTempDirs->createTempFile(this)),
+    m_isTarStored(false),
     m_tarArchive(new TarArchive(inputDir, m_tarFile, this))
 {
     if(m_tarArchive->isError()) {
@@ -72,10 +123,21 @@ TarZipArchive::TarZipArchive(const QDir &inputDir, QFile *outputFile, QObject *p
 
 TarZipArchive::~TarZipArchive()
 {
-    m_tarFile->remove();
+    if(m_tarFile && !m_isTarStored) {
+        m_tarFile->remove();
+    }
 }
 
 TarArchive *TarZipArchive::archiveIndex() const
 {
     return m_tarArchive;
 }
+
+QIODevice *TarZipArchive::createTarDevice(QObject *parent) const
+{
+    if(!m_seekableFileName.isEmpty()) {
+        return new SeekableGZipFile(m_seekableFileName, parent);
+    } else {
+        return new QFile(m_tarFile->fileName(), parent);
+    }
+}
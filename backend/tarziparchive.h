@@ -6,6 +6,7 @@
 
 class QDir;
 class QFile;
+class QIODevice;
 
 class TarArchive;
 
@@ -15,16 +16,26 @@ class TarZipArchive : public QObject, public Failable
 
 public:
     TarZipArchive(QFile *inputFile, QObject *parent = nullptr);
+    TarZipArchive(QFile *inputFile, const QByteArray &checksum, QObject *parent = nullptr);
+    // With isTarCached set, the uncompressed tar of an archive that cannot be read in place
+    // is kept in the artifact store under its checksum, so that it is only inflated once
+    TarZipArchive(QFile *inputFile, const QByteArray &checksum, bool isTarCached, QObject *parent = nullptr);
     TarZipArchive(const QDir &inputDir, QFile *outputFile, QObject *parent = nullptr);
     ~TarZipArchive();
 
     TarArchive *archiveIndex() const;
 
+    // Returns a new, unopened device with the uncompressed tar contents,
+    // suitable for reading from another thread
+    QIODevice *createTarDevice(QObject *parent = nullptr) const;
+
 signals:
     void ready();
 
 private:
     QFile *m_tarFile;
+    bool m_isTarStored;
+    QString m_seekableFileName;
     TarArchive *m_tarArchive;
 };
 
@@ -1,36 +1,181 @@
 #include "tarzipuncompressor.h"
 
+#include <QSet>
+#include <QFile>
 #include <QDebug>
+#include <QThread>
+#include <QThreadPool>
+#include <QScopedPointer>
+#include <QElapsedTimer>
 #include <QFutureWatcher>
+#include <QLoggingCategory>
 #include <QtConcurrent/QtConcurrentRun>
 
 #include "tararchive.h"
 #include "tarziparchive.h"
 #include "tempdirectories.h"
 
+Q_LOGGING_CATEGORY(LOG_UNTAR, "UTR")
+
+#define CHUNK_SIZE (64 * 1024)
+#define ABORT_CHECK_INTERVAL_MS 100
+
+// Extraction workers may block waiting for the consumer, keep them off the global pool
+static QThreadPool *extractionPool()
+{
+    static QThreadPool pool;
+    return &pool;
+}
+
 TarZipUncompressor::TarZipUncompressor(QFile *tarZipFile, const QDir &targetDir, QObject *parent):
+    TarZipUncompressor(tarZipFile, targetDir, QByteArray(), parent)
+{}
+
+TarZipUncompressor::TarZipUncompressor(QFile *tarZipFile, const QDir &targetDir, const QByteArray &checksum, QObject *parent):
     QObject(parent),
-    m_tarZipArchive(new TarZipArchive(tarZipFile, this)),
-    m_targetDir(targetDir)
+    m_tarZipArchive(new TarZipArchive(tarZipFile, checksum, this)),
+    m_targetDir(targetDir),
+    m_throughput(0),
+    m_fileCount(0),
+    m_maxPendingFiles(0),
+    m_pendingBatchCount(0),
+    m_bytesWritten(0),
+    m_isAborted(0)
 {
     connect(m_tarZipArchive, &TarZipArchive::ready, this, &TarZipUncompressor::onArchiveReady);
 }
 
-void TarZipUncompressor::onArchiveReady()
+double TarZipUncompressor::throughput() const
+{
+    return m_throughput;
+}
+
+int TarZipUncompressor::fileCount() const
+{
+    return m_fileCount;
+}
+
+void TarZipUncompressor::setMaxPendingFiles(int count)
+{
+    m_maxPendingFiles = qMax(0, count);
+    m_pendingSlots.acquire(m_pendingSlots.available());
+    m_pendingSlots.release(m_maxPendingFiles);
+}
+
+void TarZipUncompressor::releaseFiles(int count)
+{
+    if(m_maxPendingFiles > 0) {
+        m_pendingSlots.release(count);
+    }
+}
+
+void TarZipUncompressor::abort()
 {
-    auto *watcher = new QFutureWatcher<void>(this);
-
-    connect(watcher, &QFutureWatcherBase::finished, this, &TarZipUncompressor::finished);
-#if QT_VERSION < 0x060000
-    watcher->setFuture(QtConcurrent::run(this, &TarZipUncompressor::extractFiles));
-#else
-    watcher->setFuture(QtConcurrent::run(&TarZipUncompressor::extractFiles, this));
-#endif
+    m_isAborted.storeRelease(1);
 }
 
-void TarZipUncompressor::extractFiles()
+void TarZipUncompressor::onArchiveReady()
 {
+    if(m_tarZipArchive->isError()) {
+        setError(m_tarZipArchive->error(), m_tarZipArchive->errorString());
+        emit finished();
+        return;
+    }
+
     const auto fileInfos = m_tarZipArchive->archiveIndex()->root()->toPreOrderList();
+    m_fileCount = std::count_if(fileInfos.cbegin(), fileInfos.cend(), [](const FileNode::FileInfo &arg) {
+        return arg.type == FileNode::Type::RegularFile;
+    });
+
+    m_elapsed.start();
+
+    if(!createDirectories(fileInfos)) {
+        emit finished();
+        return;
+    }
+
+    const auto batches = createBatches(fileInfos);
+    m_pendingBatchCount = batches.size();
+
+    if(batches.isEmpty()) {
+        finishExtraction();
+        return;
+    }
+
+    for(const auto &batch : batches) {
+        auto *watcher = new QFutureWatcher<BatchResult>(this);
+
+        connect(watcher, &QFutureWatcherBase::finished, this, [=]() {
+            onBatchFinished(watcher->result());
+            watcher->deleteLater();
+        });
+
+        watcher->setFuture(QtConcurrent::run(extractionPool(), [=]() {
+            return extractBatch(batch);
+        }));
+    }
+}
+
+void TarZipUncompressor::onBatchFinished(const BatchResult &result)
+{
+    m_bytesWritten += result.bytesWritten;
+
+    if(result.error != BackendError::NoError && !isError()) {
+        setError(result.error, result.errorString);
+    }
+
+    if(--m_pendingBatchCount == 0) {
+        finishExtraction();
+    }
+}
+
+void TarZipUncompressor::finishExtraction()
+{
+    const auto msecs = qMax<qint64>(m_elapsed.elapsed(), 1);
+    m_throughput = (m_bytesWritten * 1000.0) / msecs;
+
+    qCDebug(LOG_UNTAR).noquote() << "Extracted" << m_fileCount << "files," << m_bytesWritten << "bytes in" << msecs
+                                 << "ms (" << (m_throughput / (1024.0 * 1024.0)) << "MiB/s )";
+    emit finished();
+}
+
+QVector<TarZipUncompressor::Batch> TarZipUncompressor::createBatches(const FileNode::FileInfoList &fileInfos)
+{
+    // Distribute the files into batches of roughly equal total size,
+    // largest files first, so that each worker keeps one open archive handle
+    // and one chunk buffer at most
+    const auto batchCount = qMax(1, QThread::idealThreadCount());
+
+    QVector<Batch> batches(batchCount);
+    QVector<qint64> batchSizes(batchCount, 0);
+
+    auto regularFiles = fileInfos;
+    regularFiles.erase(std::remove_if(regularFiles.begin(), regularFiles.end(), [](const FileNode::FileInfo &arg) {
+        return arg.type != FileNode::Type::RegularFile;
+    }), regularFiles.end());
+
+    std::sort(regularFiles.begin(), regularFiles.end(), [](const FileNode::FileInfo &a, const FileNode::FileInfo &b) {
+        return a.userData.value<TarArchive::FileInfo>().size > b.userData.value<TarArchive::FileInfo>().size;
+    });
+
+    for(const auto &fileInfo : qAsConst(regularFiles)) {
+        const auto it = std::min_element(batchSizes.begin(), batchSizes.end());
+        const auto idx = std::distance(batchSizes.begin(), it);
+
+        batches[idx].append(fileInfo);
+        *it += qMax<qint64>(fileInfo.userData.value<TarArchive::FileInfo>().size, 1);
+    }
+
+    batches.erase(std::remove_if(batches.begin(), batches.end(), [](const Batch &arg) {
+        return arg.isEmpty();
+    }), batches.end());
+
+    return batches;
+}
+
+bool TarZipUncompressor::createDirectories(const FileNode::FileInfoList &fileInfos)
+{
+    QSet<QString> dirPaths;
 
     for(const auto &fileInfo : fileInfos) {
         const auto &absolutePath = fileInfo.absolutePath;
@@ -38,32 +183,112 @@ void TarZipUncompressor::extractFiles()
         if(absolutePath.isEmpty()) {
             continue;
         } else if(fileInfo.type == FileNode::Type::Directory) {
-            m_targetDir.mkpath(absolutePath);
-        } else if(!extractFile(absolutePath, m_targetDir.absoluteFilePath(absolutePath))) {
+            dirPaths.insert(absolutePath);
+        } else {
+            const auto sepIdx = absolutePath.lastIndexOf('/');
+            if(sepIdx > 0) {
+                dirPaths.insert(absolutePath.left(sepIdx));
+            }
+        }
+    }
+
+    for(const auto &dirPath : qAsConst(dirPaths)) {
+        if(!m_targetDir.mkpath(dirPath)) {
+            setError(BackendError::DiskError, QStringLiteral("Failed to create directory: %1").arg(dirPath));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+TarZipUncompressor::BatchResult TarZipUncompressor::extractBatch(const Batch &batch)
+{
+    BatchResult result = {0, BackendError::NoError, QString()};
+
+    // Each batch reads through its own device to allow concurrent seeking
+    QScopedPointer<QIODevice> tarFile(m_tarZipArchive->createTarDevice());
+
+    if(!tarFile->open(QIODevice::ReadOnly)) {
+        result.error = BackendError::DiskError;
+        result.errorString = tarFile->errorString();
+        return result;
+    }
+
+    QByteArray buf(CHUNK_SIZE, Qt::Uninitialized);
+
+    for(const auto &fileInfo : batch) {
+        if(!acquirePendingSlot()) {
+            result.error = BackendError::OperationError;
+            result.errorString = QStringLiteral("Extraction has been aborted");
+            break;
+
+        } else if(!extractFile(tarFile.data(), fileInfo, buf, result)) {
             break;
         }
+
+        emit fileExtracted(fileInfo.absolutePath);
     }
+
+    return result;
 }
 
-bool TarZipUncompressor::extractFile(const QString &src, const QString &dst)
+bool TarZipUncompressor::acquirePendingSlot()
 {
-    // TODO: Write files to disk in chunks
-    // Preferably rewrite all tar.gz operations in stream-friendly style
-    // with no intermediate files
+    // Wait in short intervals so that a blocked worker notices abort()
+    while(!m_isAborted.loadAcquire()) {
+        if(m_maxPendingFiles <= 0 || m_pendingSlots.tryAcquire(1, ABORT_CHECK_INTERVAL_MS)) {
+            return true;
+        }
+    }
 
-    QFile file(dst);
-    // TODO: check for errors
-    if(!file.open(QIODevice::WriteOnly)) {
-        setError(BackendError::DiskError, file.errorString());
+    return false;
+}
+
+bool TarZipUncompressor::extractFile(QIODevice *tarFile, const FileNode::FileInfo &fileInfo, QByteArray &buf, BatchResult &result) const
+{
+    if(!fileInfo.userData.canConvert<TarArchive::FileInfo>()) {
+        result.error = BackendError::DataError;
+        result.errorString = QStringLiteral("No valid FileData found in the node.");
+        return false;
+    }
+
+    const auto data = fileInfo.userData.value<TarArchive::FileInfo>();
+
+    if(!tarFile->seek(data.offset)) {
+        result.error = BackendError::DiskError;
+        result.errorString = tarFile->errorString();
         return false;
     }
 
-    const auto fileData = m_tarZipArchive->archiveIndex()->fileData(src);
-    if(file.write(fileData) != fileData.size()) {
-        setError(BackendError::DiskError, file.errorString());
+    QFile file(m_targetDir.absoluteFilePath(fileInfo.absolutePath));
+
+    if(!file.open(QIODevice::WriteOnly)) {
+        result.error = BackendError::DiskError;
+        result.errorString = file.errorString();
         return false;
     }
 
+    auto bytesLeft = data.size;
+
+    while(bytesLeft > 0) {
+        const auto n = tarFile->read(buf.data(), qMin<qint64>(bytesLeft, buf.size()));
+
+        if(n <= 0) {
+            result.error = BackendError::DataError;
+            result.errorString = QStringLiteral("Archive file is truncated");
+            return false;
+
+        } else if(file.write(buf.constData(), n) != n) {
+            result.error = BackendError::DiskError;
+            result.errorString = file.errorString();
+            return false;
+        }
+
+        bytesLeft -= n;
+        result.bytesWritten += n;
+    }
+
     file.close();
     return true;
 }
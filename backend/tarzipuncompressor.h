@@ -2,10 +2,16 @@
 
 #include <QDir>
 #include <QObject>
+#include <QVector>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QSemaphore>
 
 #include "failable.h"
+#include "filenode.h"
 
 class QFile;
+class QIODevice;
 class TarZipArchive;
 
 class TarZipUncompressor : public QObject, public Failable
@@ -14,18 +20,57 @@ class TarZipUncompressor : public QObject, public Failable
 
 public:
     TarZipUncompressor(QFile *tarZipFile, const QDir &targetDir, QObject *parent = nullptr);
+    TarZipUncompressor(QFile *tarZipFile, const QDir &targetDir, const QByteArray &checksum, QObject *parent = nullptr);
+
+    // Average extraction speed in bytes per second, valid after finished()
+    double throughput() const;
+
+    // Number of regular files in the archive, valid after the extraction has started
+    int fileCount() const;
+
+    // Limit the number of extracted files not yet released by the consumer (0 = unlimited).
+    // Must be set before the extraction starts.
+    void setMaxPendingFiles(int count);
+
+public slots:
+    void releaseFiles(int count = 1);
+    void abort();
 
 signals:
+    // Emitted from a worker thread, filePath is relative to the target directory
+    void fileExtracted(const QString &filePath);
     void finished();
 
 private slots:
     void onArchiveReady();
 
 private:
-    void extractFiles();
-    bool extractFile(const QString &src, const QString &dst);
+    struct BatchResult {
+        qint64 bytesWritten;
+        BackendError::ErrorType error;
+        QString errorString;
+    };
+
+    using Batch = FileNode::FileInfoList;
+
+    void onBatchFinished(const BatchResult &result);
+    void finishExtraction();
+
+    bool createDirectories(const FileNode::FileInfoList &fileInfos);
+    static QVector<Batch> createBatches(const FileNode::FileInfoList &fileInfos);
+    BatchResult extractBatch(const Batch &batch);
+    bool extractFile(QIODevice *tarFile, const FileNode::FileInfo &fileInfo, QByteArray &buf, BatchResult &result) const;
+    bool acquirePendingSlot();
 
     TarZipArchive *m_tarZipArchive;
     QDir m_targetDir;
+    double m_throughput;
+    int m_fileCount;
+    int m_maxPendingFiles;
+    int m_pendingBatchCount;
+    qint64 m_bytesWritten;
+    QElapsedTimer m_elapsed;
+    QSemaphore m_pendingSlots;
+    QAtomicInt m_isAborted;
 };
 
@@ -0,0 +1,19 @@
+QT -= gui
+QT += testlib
+
+TEMPLATE = app
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_screenframeconverter
+
+include(../../../qflipper_common.pri)
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    tst_screenframeconverter.cpp \
+    ../../screenframeconverter.cpp
+
+HEADERS += \
+    ../../screenframeconverter.h
@@ -0,0 +1,175 @@
+#include <QtTest>
+
+#include <QRandomGenerator>
+
+#include "screenframeconverter.h"
+
+// The device screen, the only size used outside of the tests
+static constexpr int SCREEN_WIDTH = 128;
+static constexpr int SCREEN_HEIGHT = 64;
+
+static constexpr int RANDOM_FRAME_COUNT = 256;
+static constexpr quint32 RANDOM_SEED = 0xF11BB3E7;
+
+static QByteArray singleBitImage(int width, int height, int bit)
+{
+    QByteArray image((width * height) / 8, 0x0);
+    image[bit / 8] = (char)(1 << (bit % 8));
+    return image;
+}
+
+static QByteArray randomImage(QRandomGenerator &generator, int width, int height)
+{
+    QByteArray image((width * height) / 8, Qt::Uninitialized);
+
+    for(auto &byte : image) {
+        byte = (char)generator.bounded(256);
+    }
+
+    return image;
+}
+
+class TestScreenFrameConverter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void singleBitImagesMatchGeneric_data();
+    void singleBitImagesMatchGeneric();
+
+    void randomFramesMatchGeneric();
+    void randomFramesRoundTrip();
+
+    void unalignedImagesFallBack();
+
+    void benchmarkToScreenStream_data();
+    void benchmarkToScreenStream();
+    void benchmarkToVirtualDisplay_data();
+    void benchmarkToVirtualDisplay();
+};
+
+void TestScreenFrameConverter::singleBitImagesMatchGeneric_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+
+    QTest::newRow("8x8") << 8 << 8;
+    QTest::newRow("16x8") << 16 << 8;
+    QTest::newRow("8x16") << 8 << 16;
+    QTest::newRow("screen") << SCREEN_WIDTH << SCREEN_HEIGHT;
+}
+
+void TestScreenFrameConverter::singleBitImagesMatchGeneric()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+
+    // Every pixel of the image, one at a time, so a misplaced bit is pinpointed
+    for(auto bit = 0; bit < width * height; ++bit) {
+        const auto image = singleBitImage(width, height, bit);
+
+        const auto screenStream = ScreenFrameConverter::toScreenStream(image, width, height);
+        QVERIFY2(screenStream == ScreenFrameConverter::toScreenStreamGeneric(image, width, height),
+                 qPrintable(QStringLiteral("toScreenStream, bit %1").arg(bit)));
+
+        const auto virtualDisplay = ScreenFrameConverter::toVirtualDisplay(image, width, height);
+        QVERIFY2(virtualDisplay == ScreenFrameConverter::toVirtualDisplayGeneric(image, width, height),
+                 qPrintable(QStringLiteral("toVirtualDisplay, bit %1").arg(bit)));
+    }
+}
+
+void TestScreenFrameConverter::randomFramesMatchGeneric()
+{
+    QRandomGenerator generator(RANDOM_SEED);
+
+    for(auto i = 0; i < RANDOM_FRAME_COUNT; ++i) {
+        const auto frame = randomImage(generator, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+        QCOMPARE(ScreenFrameConverter::toScreenStream(frame, SCREEN_WIDTH, SCREEN_HEIGHT),
+                 ScreenFrameConverter::toScreenStreamGeneric(frame, SCREEN_WIDTH, SCREEN_HEIGHT));
+        QCOMPARE(ScreenFrameConverter::toVirtualDisplay(frame, SCREEN_WIDTH, SCREEN_HEIGHT),
+                 ScreenFrameConverter::toVirtualDisplayGeneric(frame, SCREEN_WIDTH, SCREEN_HEIGHT));
+    }
+}
+
+void TestScreenFrameConverter::randomFramesRoundTrip()
+{
+    QRandomGenerator generator(RANDOM_SEED);
+
+    for(auto i = 0; i < RANDOM_FRAME_COUNT; ++i) {
+        const auto frame = randomImage(generator, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+        const auto screenStream = ScreenFrameConverter::toScreenStream(frame, SCREEN_WIDTH, SCREEN_HEIGHT);
+        QCOMPARE(ScreenFrameConverter::toVirtualDisplay(screenStream, SCREEN_WIDTH, SCREEN_HEIGHT), frame);
+
+        const auto virtualDisplay = ScreenFrameConverter::toVirtualDisplay(frame, SCREEN_WIDTH, SCREEN_HEIGHT);
+        QCOMPARE(ScreenFrameConverter::toScreenStream(virtualDisplay, SCREEN_WIDTH, SCREEN_HEIGHT), frame);
+    }
+}
+
+void TestScreenFrameConverter::unalignedImagesFallBack()
+{
+    QRandomGenerator generator(RANDOM_SEED);
+
+    // Width divisible by 8 (XBM rows are whole bytes), height is not
+    constexpr auto width = 16;
+    constexpr auto height = 12;
+
+    const auto image = randomImage(generator, width, height);
+
+    QCOMPARE(ScreenFrameConverter::toScreenStream(image, width, height),
+             ScreenFrameConverter::toScreenStreamGeneric(image, width, height));
+    QCOMPARE(ScreenFrameConverter::toVirtualDisplay(image, width, height),
+             ScreenFrameConverter::toVirtualDisplayGeneric(image, width, height));
+}
+
+void TestScreenFrameConverter::benchmarkToScreenStream_data()
+{
+    QTest::addColumn<bool>("isGeneric");
+
+    QTest::newRow("block") << false;
+    QTest::newRow("generic") << true;
+}
+
+void TestScreenFrameConverter::benchmarkToScreenStream()
+{
+    QFETCH(bool, isGeneric);
+
+    QRandomGenerator generator(RANDOM_SEED);
+    const auto frame = randomImage(generator, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    QByteArray result;
+
+    QBENCHMARK {
+        result = isGeneric ? ScreenFrameConverter::toScreenStreamGeneric(frame, SCREEN_WIDTH, SCREEN_HEIGHT) :
+                             ScreenFrameConverter::toScreenStream(frame, SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+
+    QCOMPARE(result.size(), frame.size());
+}
+
+void TestScreenFrameConverter::benchmarkToVirtualDisplay_data()
+{
+    benchmarkToScreenStream_data();
+}
+
+void TestScreenFrameConverter::benchmarkToVirtualDisplay()
+{
+    QFETCH(bool, isGeneric);
+
+    QRandomGenerator generator(RANDOM_SEED);
+    const auto frame = randomImage(generator, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    QByteArray result;
+
+    QBENCHMARK {
+        result = isGeneric ? ScreenFrameConverter::toVirtualDisplayGeneric(frame, SCREEN_WIDTH, SCREEN_HEIGHT) :
+                             ScreenFrameConverter::toVirtualDisplay(frame, SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+
+    QCOMPARE(result.size(), frame.size());
+}
+
+QTEST_MAIN(TestScreenFrameConverter)
+
+#include "tst_screenframeconverter.moc"
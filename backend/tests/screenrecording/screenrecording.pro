@@ -0,0 +1,24 @@
+QT -= gui
+QT += testlib
+
+TEMPLATE = app
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_screenrecording
+
+include(../../../qflipper_common.pri)
+
+INCLUDEPATH += $$PWD/../.. $$PWD/../../serialdevice
+
+SOURCES += \
+    tst_screenrecording.cpp \
+    ../../failable.cpp \
+    ../../serialdevice/screenplayer.cpp \
+    ../../serialdevice/screenrecording.cpp
+
+HEADERS += \
+    ../../failable.h \
+    ../../screenframe.h \
+    ../../serialdevice/screenplayer.h \
+    ../../serialdevice/screenrecording.h
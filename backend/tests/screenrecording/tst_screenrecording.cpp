@@ -0,0 +1,226 @@
+#include <QtTest>
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QRandomGenerator>
+
+#include "screenplayer.h"
+#include "screenrecording.h"
+
+using namespace Flipper;
+using namespace Zero;
+
+static constexpr int SCREEN_WIDTH = 128;
+static constexpr int SCREEN_HEIGHT = 64;
+static constexpr int SCREEN_BYTES = (SCREEN_WIDTH * SCREEN_HEIGHT) / 8;
+
+static constexpr quint32 RANDOM_SEED = 0x5C4EE11;
+static constexpr quint32 FRAME_INTERVAL_MS = 10;
+
+static QByteArray randomBytes(QRandomGenerator &generator, int size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+
+    for(auto &byte : data) {
+        byte = (char)generator.bounded(256);
+    }
+
+    return data;
+}
+
+static ScreenFrame makeFrame(const QByteArray &pixelData, int height = SCREEN_HEIGHT)
+{
+    return {pixelData, QSize(SCREEN_WIDTH, height), Qt::LandscapeOrientation, QRect()};
+}
+
+class TestScreenRecording : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void rleRoundTrip_data();
+    void rleRoundTrip();
+    void rleRejectsTruncatedData();
+
+    void playerSeeksToKeyFrames();
+    void playerFollowsFrameSizeChange();
+    void playerRecoversMissingIndex();
+
+private:
+    QString recordFrames(const QVector<ScreenFrame> &frames, bool isFinished = true);
+
+    QScopedPointer<QTemporaryDir> m_tempDir;
+};
+
+void TestScreenRecording::init()
+{
+    m_tempDir.reset(new QTemporaryDir);
+    QVERIFY(m_tempDir->isValid());
+}
+
+void TestScreenRecording::rleRoundTrip_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QRandomGenerator generator(RANDOM_SEED);
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("single byte") << QByteArray(1, 'x');
+    QTest::newRow("random") << randomBytes(generator, SCREEN_BYTES);
+
+    // Mostly blank screen with a few pixels set
+    auto sparse = QByteArray(SCREEN_BYTES, 0x0);
+    for(auto i = 0; i < 32; ++i) {
+        sparse[generator.bounded(SCREEN_BYTES)] = (char)generator.bounded(1, 256);
+    }
+
+    QTest::newRow("sparse") << sparse;
+    QTest::newRow("dense") << QByteArray(SCREEN_BYTES, '\xff');
+
+    // No two neighbouring bytes are equal, so everything is a literal
+    QByteArray alternating(SCREEN_BYTES, Qt::Uninitialized);
+    for(auto i = 0; i < alternating.size(); ++i) {
+        alternating[i] = (char)(i & 1 ? 0x55 : 0xaa);
+    }
+
+    QTest::newRow("alternating") << alternating;
+
+    // A single control byte covers at most 128 bytes
+    for(const auto length : {2, 3, 127, 128, 129, 255, 256, 257}) {
+        QTest::addRow("repeat %d", length) << QByteArray(3, 'a') + QByteArray(length, 'b') + QByteArray("cd");
+        QTest::addRow("literal %d", length) << QByteArray(1, 'a') + randomBytes(generator, length).replace('a', 'z') + QByteArray(1, 'a');
+    }
+}
+
+void TestScreenRecording::rleRoundTrip()
+{
+    QFETCH(QByteArray, data);
+
+    const auto encoded = ScreenRecording::encodeRLE(data);
+    QCOMPARE(ScreenRecording::decodedSizeRLE(encoded.constData(), encoded.size()), data.size());
+
+    QByteArray decoded(data.size(), Qt::Uninitialized);
+    QVERIFY(ScreenRecording::decodeRLE(encoded.constData(), encoded.size(), decoded));
+    QCOMPARE(decoded, data);
+}
+
+void TestScreenRecording::rleRejectsTruncatedData()
+{
+    QRandomGenerator generator(RANDOM_SEED);
+
+    const auto data = randomBytes(generator, SCREEN_BYTES);
+    const auto encoded = ScreenRecording::encodeRLE(data);
+    const auto truncatedSize = encoded.size() - 1;
+
+    QCOMPARE(ScreenRecording::decodedSizeRLE(encoded.constData(), truncatedSize), -1);
+
+    QByteArray decoded(data.size(), Qt::Uninitialized);
+    QVERIFY(!ScreenRecording::decodeRLE(encoded.constData(), truncatedSize, decoded));
+
+    // Output buffer too small for the data
+    decoded.resize(data.size() - 1);
+    QVERIFY(!ScreenRecording::decodeRLE(encoded.constData(), encoded.size(), decoded));
+}
+
+void TestScreenRecording::playerSeeksToKeyFrames()
+{
+    QRandomGenerator generator(RANDOM_SEED);
+
+    // Long enough for several keyframes, with small changes in between as on a real screen
+    QVector<ScreenFrame> frames;
+    auto pixelData = randomBytes(generator, SCREEN_BYTES);
+
+    for(auto i = 0; i < 200; ++i) {
+        for(auto j = 0; j < 8; ++j) {
+            pixelData[generator.bounded(SCREEN_BYTES)] = (char)generator.bounded(256);
+        }
+
+        frames.append(makeFrame(pixelData));
+    }
+
+    ScreenPlayer player;
+    QVERIFY2(player.open(QUrl::fromLocalFile(recordFrames(frames))), qPrintable(player.errorString()));
+    QCOMPARE(player.duration(), (qint64)(frames.size() - 1) * FRAME_INTERVAL_MS);
+
+    // Keyframes, frames right after them, and back to the start
+    for(const auto index : {65, 130, 131, 199, 64, 0, 100}) {
+        player.seek(index * FRAME_INTERVAL_MS);
+        QVERIFY2(player.screenFrame().pixelData == frames.at(index).pixelData, qPrintable(QStringLiteral("frame %1").arg(index)));
+    }
+}
+
+void TestScreenRecording::playerFollowsFrameSizeChange()
+{
+    QRandomGenerator generator(RANDOM_SEED);
+
+    QVector<ScreenFrame> frames;
+
+    for(auto i = 0; i < 10; ++i) {
+        frames.append(makeFrame(randomBytes(generator, SCREEN_BYTES)));
+    }
+
+    for(auto i = 0; i < 10; ++i) {
+        frames.append(makeFrame(randomBytes(generator, SCREEN_BYTES / 2), SCREEN_HEIGHT / 2));
+    }
+
+    for(auto i = 0; i < 10; ++i) {
+        frames.append(makeFrame(randomBytes(generator, SCREEN_BYTES)));
+    }
+
+    ScreenPlayer player;
+    QVERIFY2(player.open(QUrl::fromLocalFile(recordFrames(frames))), qPrintable(player.errorString()));
+
+    for(auto i = 0; i < frames.size(); ++i) {
+        player.seek(i * FRAME_INTERVAL_MS);
+        QVERIFY2(player.screenFrame().pixelData == frames.at(i).pixelData, qPrintable(QStringLiteral("frame %1").arg(i)));
+    }
+}
+
+void TestScreenRecording::playerRecoversMissingIndex()
+{
+    QRandomGenerator generator(RANDOM_SEED);
+
+    QVector<ScreenFrame> frames;
+
+    for(auto i = 0; i < 100; ++i) {
+        frames.append(makeFrame(randomBytes(generator, SCREEN_BYTES)));
+    }
+
+    // As if the application had exited during the recording
+    ScreenPlayer player;
+    QVERIFY2(player.open(QUrl::fromLocalFile(recordFrames(frames, false))), qPrintable(player.errorString()));
+    QCOMPARE(player.duration(), (qint64)(frames.size() - 1) * FRAME_INTERVAL_MS);
+
+    player.seek(70 * FRAME_INTERVAL_MS);
+    QCOMPARE(player.screenFrame().pixelData, frames.at(70).pixelData);
+}
+
+QString TestScreenRecording::recordFrames(const QVector<ScreenFrame> &frames, bool isFinished)
+{
+    const auto fileName = m_tempDir->filePath(QStringLiteral("recording.fzsr"));
+
+    QFile file(fileName);
+    ScreenRecordingWriter writer;
+
+    if(!file.open(QIODevice::WriteOnly) || !writer.begin(&file, frames.first().size)) {
+        return QString();
+    }
+
+    for(auto i = 0; i < frames.size(); ++i) {
+        if(!writer.writeFrame(i * FRAME_INTERVAL_MS, frames.at(i))) {
+            return QString();
+        }
+    }
+
+    if(isFinished && !writer.finish()) {
+        return QString();
+    }
+
+    return fileName;
+}
+
+QTEST_MAIN(TestScreenRecording)
+
+#include "tst_screenrecording.moc"
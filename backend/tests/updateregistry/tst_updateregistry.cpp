@@ -0,0 +1,221 @@
+#include <QtTest>
+
+#include <QDir>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QStandardPaths>
+
+#include "updateregistry.h"
+
+using namespace Flipper;
+
+static const QByteArray DIRECTORY_ETAG = QByteArrayLiteral("\"directory-v1\"");
+
+static const QByteArray DIRECTORY_JSON = QByteArrayLiteral(R"({
+    "channels": [{
+        "id": "release",
+        "title": "Release",
+        "description": "Stable release",
+        "versions": [{
+            "version": "0.60.0",
+            "changelog": "",
+            "timestamp": 1650000000,
+            "files": [{
+                "target": "f7",
+                "type": "update_tgz",
+                "url": "http://127.0.0.1/flipper-z-f7-update-0.60.0.tgz",
+                "sha256": "0000000000000000000000000000000000000000000000000000000000000000"
+            }]
+        }]
+    }]
+})");
+
+/* Minimal HTTP/1.1 stand-in serving a single directory document.
+ * Requests carrying a matching If-None-Match get an empty 304 response,
+ * unknown paths get a 404. */
+
+class DirectoryServer : public QTcpServer
+{
+public:
+    int requestCount = 0;
+    int fullResponseCount = 0;
+    int notModifiedCount = 0;
+    QByteArray lastIfNoneMatch;
+
+    const QString url(const QString &path = QStringLiteral("/directory.json")) const
+    {
+        return QStringLiteral("http://127.0.0.1:%1%2").arg(serverPort()).arg(path);
+    }
+
+protected:
+    void incomingConnection(qintptr handle) override
+    {
+        auto *socket = new QTcpSocket(this);
+        socket->setSocketDescriptor(handle);
+
+        connect(socket, &QTcpSocket::readyRead, this, [=]() {
+            auto request = socket->property("request").toByteArray() + socket->readAll();
+
+            // Serve each request once its header is complete, keeping any pipelined leftovers
+            for(auto end = request.indexOf("\r\n\r\n"); end >= 0; end = request.indexOf("\r\n\r\n")) {
+                respond(socket, request.left(end));
+                request.remove(0, end + 4);
+            }
+
+            socket->setProperty("request", request);
+        });
+
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+
+private:
+    void respond(QTcpSocket *socket, const QByteArray &header)
+    {
+        ++requestCount;
+
+        const auto lines = header.split('\n');
+        const auto path = lines.first().split(' ').value(1);
+
+        lastIfNoneMatch.clear();
+
+        for(const auto &line : lines) {
+            if(line.toLower().startsWith("if-none-match:")) {
+                lastIfNoneMatch = line.mid(line.indexOf(':') + 1).trimmed();
+            }
+        }
+
+        QByteArray response;
+
+        if(path != "/directory.json") {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+        } else if(lastIfNoneMatch == DIRECTORY_ETAG) {
+            ++notModifiedCount;
+            response = "HTTP/1.1 304 Not Modified\r\nETag: " + DIRECTORY_ETAG + "\r\n\r\n";
+
+        } else {
+            ++fullResponseCount;
+            response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nETag: " + DIRECTORY_ETAG +
+                       "\r\nContent-Length: " + QByteArray::number(DIRECTORY_JSON.size()) + "\r\n\r\n" + DIRECTORY_JSON;
+        }
+
+        socket->write(response);
+    }
+};
+
+class TestRegistry : public UpdateRegistry
+{
+public:
+    TestRegistry(const QString &directoryUrl):
+        UpdateRegistry(directoryUrl)
+    {}
+
+private:
+    const QString updateChannel() const override
+    {
+        return QStringLiteral("release");
+    }
+};
+
+class TestUpdateRegistry : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void unchangedDirectoryCostsOne304();
+    void cachedDirectoryIsServedBeforeNetwork();
+    void changingUrlDropsPreviousChannels();
+
+private:
+    static bool waitForCheck(UpdateRegistry &registry);
+    DirectoryServer m_server;
+};
+
+void TestUpdateRegistry::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_server.listen(QHostAddress::LocalHost));
+}
+
+void TestUpdateRegistry::init()
+{
+    QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).removeRecursively();
+
+    m_server.requestCount = 0;
+    m_server.fullResponseCount = 0;
+    m_server.notModifiedCount = 0;
+}
+
+void TestUpdateRegistry::unchangedDirectoryCostsOne304()
+{
+    TestRegistry registry(m_server.url());
+
+    QVERIFY(waitForCheck(registry));
+    QCOMPARE(registry.state(), UpdateRegistry::State::Ready);
+    QCOMPARE(registry.rowCount(), 1);
+    QCOMPARE(m_server.fullResponseCount, 1);
+
+    QSignalSpy resetSpy(&registry, &QAbstractItemModel::modelReset);
+    QSignalSpy versionSpy(&registry, &UpdateRegistry::latestVersionChanged);
+
+    registry.check();
+
+    QVERIFY(waitForCheck(registry));
+    QCOMPARE(m_server.requestCount, 2);
+    QCOMPARE(m_server.notModifiedCount, 1);
+    QCOMPARE(m_server.fullResponseCount, 1);
+    QCOMPARE(m_server.lastIfNoneMatch, DIRECTORY_ETAG);
+
+    // Nothing is parsed or reset for an unchanged directory
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(versionSpy.count(), 0);
+    QCOMPARE(registry.state(), UpdateRegistry::State::Ready);
+}
+
+void TestUpdateRegistry::cachedDirectoryIsServedBeforeNetwork()
+{
+    {
+        TestRegistry registry(m_server.url());
+        QVERIFY(waitForCheck(registry));
+    }
+
+    // A fresh instance, as after a restart
+    TestRegistry registry(m_server.url());
+
+    QCOMPARE(registry.state(), UpdateRegistry::State::Ready);
+    QCOMPARE(registry.rowCount(), 1);
+    QCOMPARE(m_server.requestCount, 1);
+
+    QVERIFY(waitForCheck(registry));
+    QCOMPARE(m_server.requestCount, 2);
+    QCOMPARE(m_server.notModifiedCount, 1);
+    QCOMPARE(m_server.fullResponseCount, 1);
+}
+
+void TestUpdateRegistry::changingUrlDropsPreviousChannels()
+{
+    TestRegistry registry(m_server.url());
+
+    QVERIFY(waitForCheck(registry));
+    QCOMPARE(registry.rowCount(), 1);
+
+    registry.setDirectoryUrl(m_server.url(QStringLiteral("/missing.json")));
+
+    QCOMPARE(registry.rowCount(), 0);
+    QVERIFY(waitForCheck(registry));
+    QCOMPARE(registry.state(), UpdateRegistry::State::ErrorOccured);
+    QCOMPARE(registry.rowCount(), 0);
+}
+
+bool TestUpdateRegistry::waitForCheck(UpdateRegistry &registry)
+{
+    QSignalSpy spy(&registry, &UpdateRegistry::checkFinished);
+    return spy.wait(5000);
+}
+
+QTEST_MAIN(TestUpdateRegistry)
+
+#include "tst_updateregistry.moc"
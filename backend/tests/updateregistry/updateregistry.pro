@@ -0,0 +1,27 @@
+QT -= gui
+QT += network testlib
+
+TEMPLATE = app
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_updateregistry
+
+include(../../../qflipper_common.pri)
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    tst_updateregistry.cpp \
+    ../../failable.cpp \
+    ../../flipperupdates.cpp \
+    ../../remotefilefetcher.cpp \
+    ../../updateregistry.cpp \
+    ../../versioninfo.cpp
+
+HEADERS += \
+    ../../failable.h \
+    ../../flipperupdates.h \
+    ../../remotefilefetcher.h \
+    ../../updateregistry.h \
+    ../../versioninfo.h
@@ -10,11 +10,18 @@
 #include <QBuffer>
 #include <QTimer>
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QCryptographicHash>
 
 #include "remotefilefetcher.h"
 
 Q_LOGGING_CATEGORY(CATEGORY_UPDATES, "UPD")
 
+#define CACHE_DIR_NAME QStringLiteral("directory")
+
 using namespace Flipper;
 
 UpdateRegistry::UpdateRegistry(const QString &directoryUrl, QObject *parent):
@@ -26,56 +33,88 @@ UpdateRegistry::UpdateRegistry(const QString &directoryUrl, QObject *parent):
     connect(this, &UpdateRegistry::stateChanged, this, &UpdateRegistry::latestVersionChanged);
     connect(m_checkTimer, &QTimer::timeout, this, &UpdateRegistry::check);
 
+    // Show the last known directory right away, then revalidate it in the background
+    if(loadCachedDirectory()) {
+        setState(State::Ready);
+    }
+
     check();
 }
 
 void UpdateRegistry::setDirectoryUrl(const QString &directoryUrl)
 {
+    if(m_directoryUrl == directoryUrl) {
+        return;
+    }
+
     m_directoryUrl = directoryUrl;
+    m_eTag.clear();
+    m_lastModified.clear();
+    m_checksum.clear();
+
+    // Never present the channels of the previous directory as the new one's
+    if(!m_channels.isEmpty()) {
+        beginResetModel();
+        m_channels.clear();
+        endResetModel();
+    }
+
+    if(loadCachedDirectory()) {
+        setState(State::Ready);
+    } else {
+        setState(State::Unknown);
+    }
+
     check();
 }
 
-void UpdateRegistry::fillFromJson(const QByteArray &text)
+bool UpdateRegistry::fillFromJson(const QByteArray &text)
 {
-    beginRemoveRows(QModelIndex(), 0, m_channels.size() - 1);
-    m_channels.clear();
-    endRemoveRows();
-
     const auto doc = QJsonDocument::fromJson(text);
 
     if(doc.isNull()) {
         qCCritical(CATEGORY_UPDATES) << "Failed to parse the document";
-        return;
+        return false;
     } else if(!doc.isObject()) {
         qCCritical(CATEGORY_UPDATES) << "Json document is not an object";
-        return;
+        return false;
     }
 
     const auto &obj = doc.object();
 
     if(!obj.contains("channels")) {
         qCCritical(CATEGORY_UPDATES) << "No channels data in json file";
-        return;
+        return false;
     } else if(!obj["channels"].isArray()) {
         qCCritical(CATEGORY_UPDATES) << "Expected to get an array of channels";
-        return;
+        return false;
     }
 
     const auto &arr = obj["channels"].toArray();
+    ChannelMap channels;
 
     try {
 
         for(const auto &val : arr) {
             const Updates::ChannelInfo info(val);
-
-            beginInsertRows(QModelIndex(), m_channels.size(), m_channels.size());
-            m_channels.insert(info.name(), info);
-            endInsertRows();
+            channels.insert(info.name(), info);
         }
 
     } catch(std::runtime_error &e) {
         qCCritical(CATEGORY_UPDATES) << "Failed to parse update information:" << e.what();
+        return false;
     }
+
+    beginResetModel();
+    m_channels = channels;
+    endResetModel();
+
+    // Otherwise the state change that follows will signal it
+    if(m_state == State::Ready) {
+        emit latestVersionChanged();
+    }
+
+    return true;
 }
 
 const QStringList UpdateRegistry::channelNames() const
@@ -148,40 +187,115 @@ void UpdateRegistry::check()
 {
     if(m_directoryUrl.isEmpty()) {
         setState(State::ErrorOccured);
+        emit checkFinished();
         return;
     }
 
-    setState(State::Checking);
+    // Keep serving the data already present while revalidating
+    if(m_channels.isEmpty()) {
+        setState(State::Checking);
+    }
 
     auto *fetcher = new RemoteFileFetcher(this);
     auto *buf = new QBuffer(this);
 
+    fetcher->setCacheValidators(m_eTag, m_lastModified);
+
     fetcher->connect(fetcher, &RemoteFileFetcher::finished, this, [=]() {
         if(fetcher->isError()) {
             qCCritical(CATEGORY_UPDATES).noquote() << "Failed to fetch update information:" << fetcher->errorString();
-            setState(State::ErrorOccured);
+            setState(m_channels.isEmpty() ? State::ErrorOccured : State::Ready);
+
+        } else if(fetcher->isNotModified() || (!m_channels.isEmpty() && fetcher->checksum() == m_checksum)) {
+            qCDebug(CATEGORY_UPDATES).noquote() << "Update information not modified at" << m_directoryUrl;
+            setState(m_channels.isEmpty() ? State::ErrorOccured : State::Ready);
 
         } else {
             qCDebug(CATEGORY_UPDATES).noquote() << "Fetched update information from" << m_directoryUrl;
             buf->open(QIODevice::ReadOnly);
 
-            fillFromJson(buf->readAll());
+            const auto text = buf->readAll();
+
+            if(fillFromJson(text)) {
+                m_eTag = fetcher->eTag();
+                m_lastModified = fetcher->lastModified();
+                m_checksum = fetcher->checksum();
+                saveCachedDirectory(text);
+            }
+
             setState(m_channels.isEmpty() ? State::ErrorOccured : State::Ready);
         }
 
         fetcher->deleteLater();
         buf->deleteLater();
+
+        emit checkFinished();
     });
 
     if(!fetcher->fetch(m_directoryUrl, buf)) {
         qCCritical(CATEGORY_UPDATES).noquote() << "Failed to fetch update information:" << fetcher->errorString();
-        setState(State::ErrorOccured);
+        setState(m_channels.isEmpty() ? State::ErrorOccured : State::Ready);
         buf->deleteLater();
+
+        emit checkFinished();
     }
 
     m_checkTimer->start(std::chrono::minutes(10));
 }
 
+const QString UpdateRegistry::cacheFilePath(const QString &extension) const
+{
+    QDir cacheDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+
+    if(!cacheDir.mkpath(CACHE_DIR_NAME) || !cacheDir.cd(CACHE_DIR_NAME)) {
+        return QString();
+    }
+
+    const auto urlHash = QCryptographicHash::hash(m_directoryUrl.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return cacheDir.absoluteFilePath(QStringLiteral("%1.%2").arg(QString::fromLatin1(urlHash), extension));
+}
+
+bool UpdateRegistry::loadCachedDirectory()
+{
+    QFile dataFile(cacheFilePath(QStringLiteral("json")));
+    QFile metaFile(cacheFilePath(QStringLiteral("meta")));
+
+    if(!dataFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const auto text = dataFile.readAll();
+
+    if(!fillFromJson(text)) {
+        return false;
+    }
+
+    m_checksum = QCryptographicHash::hash(text, QCryptographicHash::Sha256).toHex();
+
+    // Validators are only useful if they match the cached data
+    if(metaFile.open(QIODevice::ReadOnly)) {
+        m_eTag = metaFile.readLine().trimmed();
+        m_lastModified = metaFile.readLine().trimmed();
+    }
+
+    qCDebug(CATEGORY_UPDATES).noquote() << "Loaded cached update information for" << m_directoryUrl;
+    return true;
+}
+
+void UpdateRegistry::saveCachedDirectory(const QByteArray &text)
+{
+    QSaveFile dataFile(cacheFilePath(QStringLiteral("json")));
+    QSaveFile metaFile(cacheFilePath(QStringLiteral("meta")));
+
+    const auto meta = m_eTag + '\n' + m_lastModified + '\n';
+
+    if(!dataFile.open(QIODevice::WriteOnly) || (dataFile.write(text) != text.size()) || !dataFile.commit()) {
+        qCWarning(CATEGORY_UPDATES).noquote() << "Failed to cache update information:" << dataFile.errorString();
+    } else if(!metaFile.open(QIODevice::WriteOnly) || (metaFile.write(meta) != meta.size()) || !metaFile.commit()) {
+        qCWarning(CATEGORY_UPDATES).noquote() << "Failed to cache update information:" << metaFile.errorString();
+    }
+}
+
 void UpdateRegistry::setState(State newState)
 {
     if(m_state == newState) {
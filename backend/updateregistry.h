@@ -31,7 +31,7 @@ public:
     UpdateRegistry(const QString &directoryUrl, QObject *parent = nullptr);
 
     void setDirectoryUrl(const QString &directoryUrl);
-    void fillFromJson(const QByteArray &text);
+    bool fillFromJson(const QByteArray &text);
 
     State state() const;
     const QStringList channelNames() const;
@@ -47,6 +47,8 @@ public:
 signals:
     void stateChanged();
     void latestVersionChanged();
+    // Emitted after every check(), even if the state did not change
+    void checkFinished();
 
 public slots:
     void check();
@@ -55,7 +57,14 @@ private:
     virtual const QString updateChannel() const = 0;
     void setState(State newState);
 
+    const QString cacheFilePath(const QString &extension) const;
+    bool loadCachedDirectory();
+    void saveCachedDirectory(const QByteArray &text);
+
     QString m_directoryUrl;
+    QByteArray m_eTag;
+    QByteArray m_lastModified;
+    QByteArray m_checksum;
     QTimer *m_checkTimer;
     ChannelMap m_channels;
     State m_state;